@@ -11,6 +11,8 @@ import (
 	"os"
 	"regexp"
 	"strconv"
+	"strings"
+	"sync"
 	"time"
 
 	"github.com/julienschmidt/httprouter"
@@ -96,6 +98,8 @@ func (p *Device) CheckLimit() bool {
 		return true
 	}
 
+	// The limits are the LowerBound / UpperBound of the params in the device schema,
+	// driver/isode-radio.xml, which the driver checks the same values against.
 	VSWR, _ := strconv.Atoi(p.VSWR)
 	if VSWR < 10 || VSWR > 100 {
 		return false
@@ -107,7 +111,7 @@ func (p *Device) CheckLimit() bool {
 	}
 
 	PowerSupplyConsumption, _ := strconv.Atoi(p.PowerSupplyConsumption)
-	if PowerSupplyConsumption < 0 || PowerSupplyConsumption > 100000 {
+	if PowerSupplyConsumption < 1 || PowerSupplyConsumption > 100000 {
 		return false
 	}
 
@@ -121,6 +125,16 @@ func (p *Device) CheckLimit() bool {
 		return false
 	}
 
+	Frequency, _ := strconv.Atoi(p.Frequency)
+	if Frequency < 3000 || Frequency > 30000 {
+		return false
+	}
+
+	TransmissionPower, _ := strconv.Atoi(p.TransmissionPower)
+	if TransmissionPower < 1 || TransmissionPower > 20000 {
+		return false
+	}
+
 	return true
 }
 
@@ -388,6 +402,8 @@ func EditHandler(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
 func SaveHandler(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
+	before, _ := LoadDeviceInfo(ps.ByName("device"))
+
 	val_VSWR := r.FormValue("VSWR")
 	val_PowerSupplyVoltage := r.FormValue("PowerSupplyVoltage")
 	val_PowerSupplyConsumption := r.FormValue("PowerSupplyConsumption")
@@ -436,6 +452,7 @@ func SaveHandler(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 		http.Error(w, err.Error(), http.StatusInternalServerError)
 		return
 	}
+	PublishChanges(ps.ByName("device"), before)
 	http.Redirect(w, r, "/view/"+ps.ByName("device"), http.StatusFound)
 }
 
@@ -464,6 +481,10 @@ func MakeHandler(fn func(http.ResponseWriter, *http.Request, string)) http.Handl
 
 func GetAllDeviceParams(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
+	if NotModified(w, r, DeviceETag(ps.ByName("device"))) {
+		return
+	}
+
 	device_info, err := LoadDeviceInfo(ps.ByName("device"))
 	if err == nil {
 		json.NewEncoder(w).Encode(device_info)
@@ -472,6 +493,8 @@ func GetAllDeviceParams(w http.ResponseWriter, r *http.Request, ps httprouter.Pa
 
 func PowerOff(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
+	before, _ := LoadDeviceInfo(ps.ByName("device"))
+
 	var val_VSWR, val_PowerSupplyVoltage, val_PowerSupplyConsumption string
 	var val_Temperature, val_SignalLevel string
 	var val_Status, val_StartTime string
@@ -531,6 +554,8 @@ func PowerOff(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 	control_file.WriteString("[TransmissionPower][" + val_TransmissionPower + "]\n")
 	control_file.WriteString("[Enabled][" + val_Enabled + "]\n")
 
+	PublishChanges(ps.ByName("device"), before)
+
 	device_info, err := LoadDeviceInfo(ps.ByName("device"))
 	if err == nil {
 		json.NewEncoder(w).Encode(device_info)
@@ -539,6 +564,8 @@ func PowerOff(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
 func ResetDevice(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
+	before, _ := LoadDeviceInfo(ps.ByName("device"))
+
 	var val_VSWR, val_PowerSupplyVoltage, val_PowerSupplyConsumption string
 	var val_Temperature, val_SignalLevel string
 	var val_Status, val_StartTime string
@@ -604,6 +631,8 @@ func ResetDevice(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 	control_file.WriteString("[Alert][" + val_Alert + "]\n")
 	control_file.WriteString("[AlertMessage][" + val_AlertMessage + "]\n")
 
+	PublishChanges(ps.ByName("device"), before)
+
 	device_info, err := LoadDeviceInfo(ps.ByName("device"))
 	if err == nil {
 		json.NewEncoder(w).Encode(device_info)
@@ -636,6 +665,10 @@ func GetParam(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
 func GetAllDeviceStatus(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
+	if NotModified(w, r, DeviceETag(ps.ByName("device"))) {
+		return
+	}
+
 	device_info, err := LoadDeviceInfo(ps.ByName("device"))
 	map_status := map[string]string{"VSWR": device_info.VSWR,
 		"PowerSupplyVoltage":     device_info.PowerSupplyVoltage,
@@ -649,6 +682,10 @@ func GetAllDeviceStatus(w http.ResponseWriter, r *http.Request, ps httprouter.Pa
 
 func GetAllRefParams(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
 
+	if NotModified(w, r, DeviceETag(ps.ByName("device"))) {
+		return
+	}
+
 	device_info, err := LoadDeviceInfo(ps.ByName("device"))
 	map_status := map[string]string{"Status": device_info.Status,
 		"Version":        device_info.Version,
@@ -716,6 +753,177 @@ func SetControlParam(w http.ResponseWriter, r *http.Request, ps httprouter.Param
 		}
 		f.WriteString("[AlertMessage][Parameters boyond range]\n")
 	}
+
+	PublishChanges(ps.ByName("device"), device_info)
+}
+
+// Subscribers to the param changes of each device, see DeviceEvents, and the version of
+// the params of each device, see DeviceETag.
+type EventHub struct {
+	mutex       sync.Mutex
+	subscribers map[string]map[chan []byte]bool
+	versions    map[string]uint64
+}
+
+var events = &EventHub{subscribers: make(map[string]map[chan []byte]bool), versions: make(map[string]uint64)}
+
+func (h *EventHub) Subscribe(device string) chan []byte {
+
+	ch := make(chan []byte, 16)
+	h.mutex.Lock()
+	defer h.mutex.Unlock()
+	if h.subscribers[device] == nil {
+		h.subscribers[device] = make(map[chan []byte]bool)
+	}
+	h.subscribers[device][ch] = true
+	return ch
+}
+
+func (h *EventHub) Unsubscribe(device string, ch chan []byte) {
+
+	h.mutex.Lock()
+	defer h.mutex.Unlock()
+	if h.subscribers[device][ch] {
+		delete(h.subscribers[device], ch)
+		close(ch)
+	}
+}
+
+// Send an event to every subscriber of a device, and move the device on to its next
+// version. A subscriber that has fallen too far behind is dropped rather than holding up
+// the handler making the change. Its stream ends, and it gets the full state again when
+// it reconnects.
+func (h *EventHub) Publish(device string, event []byte) {
+
+	h.mutex.Lock()
+	defer h.mutex.Unlock()
+	h.versions[device]++
+	for ch := range h.subscribers[device] {
+		select {
+		case ch <- event:
+		default:
+			delete(h.subscribers[device], ch)
+			close(ch)
+		}
+	}
+}
+
+func (h *EventHub) Version(device string) uint64 {
+
+	h.mutex.Lock()
+	defer h.mutex.Unlock()
+	return h.versions[device]
+}
+
+// The entity tag of the params of a device. It changes with every change of the params,
+// and with every start of the manager, which forgets the versions.
+func DeviceETag(device string) string {
+	return fmt.Sprintf("\"%x-%d\"", start_time_.UnixNano(), events.Version(device))
+}
+
+// Set the ETag of a response, and answer 304 Not Modified if the request already has
+// that version of the params. Returns true if the response is complete. The ETag is to
+// be taken before loading the params, so that a change in between makes it stale rather
+// than the params.
+func NotModified(w http.ResponseWriter, r *http.Request, etag string) bool {
+
+	w.Header().Set("ETag", etag)
+	for _, tag := range strings.Split(r.Header.Get("If-None-Match"), ",") {
+		tag = strings.TrimSpace(tag)
+		if tag == etag || tag == "*" {
+			w.WriteHeader(http.StatusNotModified)
+			return true
+		}
+	}
+	return false
+}
+
+// Publish the params of a device that differ from 'before', the device as it was loaded
+// before the change, e.g. {"Temperature":"250","Alert":"Warning"}.
+func PublishChanges(device string, before *Device) {
+
+	after, err := LoadDeviceInfo(device)
+	if err != nil {
+		return
+	}
+
+	old_params := DeviceParams(before)
+	changed := make(map[string]string)
+	for name, value := range DeviceParams(after) {
+		if old_value, ok := old_params[name]; !ok || old_value != value {
+			changed[name] = value
+		}
+	}
+	if len(changed) == 0 {
+		return
+	}
+
+	event, _ := json.Marshal(changed)
+	events.Publish(device, event)
+}
+
+// The params of a device keyed by their names, as GetAllDeviceParams returns them.
+func DeviceParams(device_info *Device) map[string]string {
+
+	params := make(map[string]string)
+	if device_info != nil {
+		data, _ := json.Marshal(device_info)
+		json.Unmarshal(data, &params)
+	}
+	return params
+}
+
+// Stream the param changes of a device as server-sent events, starting with all of its
+// params, so that a driver hears of a change as soon as it is made rather than on its
+// next poll :
+//
+//	event: params
+//	data: {"Temperature":"250","Alert":"Warning","AlertMessage":"Parameters beyond range."}
+//
+// A comment line is sent every 15 seconds while nothing changes, so that the driver can
+// tell a quiet device from a dead connection.
+func DeviceEvents(w http.ResponseWriter, r *http.Request, ps httprouter.Params) {
+
+	flusher, ok := w.(http.Flusher)
+	if !ok {
+		http.Error(w, "Streaming not supported", http.StatusInternalServerError)
+		return
+	}
+
+	// Subscribe before loading the params, so that no change is missed in between.
+	device := ps.ByName("device")
+	ch := events.Subscribe(device)
+	defer events.Unsubscribe(device, ch)
+
+	device_info, err := LoadDeviceInfo(device)
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusInternalServerError)
+		return
+	}
+	state, _ := json.Marshal(device_info)
+
+	w.Header().Set("Content-Type", "text/event-stream")
+	w.Header().Set("Cache-Control", "no-cache")
+	fmt.Fprintf(w, "event: params\ndata: %s\n\n", state)
+	flusher.Flush()
+
+	keepalive := time.NewTicker(15 * time.Second)
+	defer keepalive.Stop()
+
+	for {
+		select {
+		case event, open := <-ch:
+			if !open {
+				return
+			}
+			fmt.Fprintf(w, "event: params\ndata: %s\n\n", event)
+		case <-keepalive.C:
+			fmt.Fprint(w, ": keepalive\n\n")
+		case <-r.Context().Done():
+			return
+		}
+		flusher.Flush()
+	}
 }
 
 func Index(w http.ResponseWriter, r *http.Request, _ httprouter.Params) {
@@ -739,5 +947,6 @@ func main() {
 	router.GET("/device/:device/poweroff", PowerOff)
 	router.GET("/device/:device/ref", GetAllRefParams)
 	router.POST("/device/:device/control", SetControlParam)
+	router.GET("/device/:device/events", DeviceEvents)
 	log.Fatal(http.ListenAndServe(":8082", router))
 }
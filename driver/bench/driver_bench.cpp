@@ -0,0 +1,348 @@
+// Google Benchmark suite of the driver's hot paths : CBOR on Red/Black shaped frames,
+// status message formatting, control message parsing, loading the schema from the XML,
+// its compiled image or the compiled profile, and a whole monitor tick against an
+// in-process mock device. The BM_FormatRegex and BM_ParsePropertyTree baselines are
+// what formatting and parsing cost before MessageTemplate and RBMessage.
+//
+// Usage : driver-bench [--benchmark_filter=<regex>] [--benchmark_out=<file> --benchmark_out_format=json]
+//
+// The driver-bench-json target runs the suite and writes driver-bench.json to the build
+// directory, for comparing results across commits with benchmark's compare.py.
+
+#include <cstdio>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+#include "../driver.h"
+#include "../schema_cache.h"
+#include "mock_device.h"
+
+#ifdef DRIVER_DEVICE_PROFILES
+#include "isode_radio_profile.h"
+#endif
+
+namespace {
+
+const std::string schema_file = DRIVER_SOURCE_DIR "/isode-radio.xml";
+const std::string std_params_file = DRIVER_SOURCE_DIR "/stdparams.xml";
+const std::string cache_dir = DRIVER_BINARY_DIR;    // Schema images, in a directory of our own
+
+const char* const status_xml = "<Status><Device>radio1</Device><DeviceType>IsodeRadio</DeviceType>"
+                               "<Param>Frequency</Param><Integer>22917</Integer></Status>";
+
+// Control messages as RB sends them, with and without indentation.
+const std::vector<std::string> control_messages = {
+    "<Control><Device>radio1</Device><DeviceType>IsodeRadio</DeviceType>"
+    "<Param>Frequency</Param><Integer>22917</Integer></Control>",
+    "<Control>\n    <Device>radio1</Device>\n    <DeviceType>IsodeRadio</DeviceType>\n"
+    "    <Param>TransmissionPower</Param>\n    <Integer>8000</Integer>\n</Control>\n",
+    "<Control><Device>radio1</Device><DeviceType>IsodeRadio</DeviceType>"
+    "<Param>SendParameters</Param></Control>",
+    "<Control><Device>radio1</Device><DeviceType>IsodeRadio</DeviceType>"
+    "<Param>Modem</Param><Enumerated>Audio</Enumerated></Control>",
+};
+
+// A status frame as it goes to RB : tag 24 around a byte string holding the encoded text.
+cbor StatusFrame(void) {
+    return cbor::tagged(24, cbor(cbor::encode(cbor(std::string(status_xml)))));
+}
+
+// The content of a frame as a CBOR map, which exercises arrays, maps and short strings.
+cbor StructuredFrame(void) {
+    cbor::map m;
+    m[cbor("Device")] = cbor("radio1");
+    m[cbor("DeviceType")] = cbor("IsodeRadio");
+    m[cbor("Param")] = cbor("Frequency");
+    m[cbor("Integer")] = cbor("22917");
+    m[cbor("Flags")] = cbor(cbor::array{cbor(true), cbor(1), cbor(-1), cbor(2.5)});
+    return cbor(m);
+}
+
+std::shared_ptr<const DeviceSchema> Schema(void) {
+    static std::shared_ptr<const DeviceSchema> schema = DeviceSchema::Load(schema_file, std_params_file);
+    return schema;
+}
+
+// Frames are written to /dev/null rather than stdout, where the results go.
+std::FILE* NullOutput(void) {
+    static std::FILE* null_output = std::fopen("/dev/null", "wb");
+    return null_output;
+}
+
+void BM_CborEncode(benchmark::State& state) {
+    cbor frame = StatusFrame();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cbor::encode(frame));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CborEncode);
+
+void BM_CborDecode(benchmark::State& state) {
+    cbor::binary encoded = cbor::encode(StatusFrame());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cbor::decode(encoded));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CborDecode);
+
+void BM_CborDecodeMap(benchmark::State& state) {
+    cbor::binary encoded = cbor::encode(StructuredFrame());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cbor::decode(encoded));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CborDecodeMap);
+
+void BM_CborCopyMap(benchmark::State& state) {
+    cbor frame = StructuredFrame();
+    for (auto _ : state) {
+        cbor copy = frame;
+        benchmark::DoNotOptimize(copy);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["sizeof"] = sizeof(cbor);
+}
+BENCHMARK(BM_CborCopyMap);
+
+void BM_CborWrite(benchmark::State& state) {
+    cbor frame = StatusFrame();
+    std::ostringstream out;
+    for (auto _ : state) {
+        out.str(std::string());
+        frame.write(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CborWrite);
+
+void BM_CborRead(benchmark::State& state) {
+    std::string encoded;
+    {
+        std::ostringstream out;
+        StatusFrame().write(out);
+        encoded = out.str();
+    }
+    std::istringstream in;
+    cbor frame;
+    for (auto _ : state) {
+        in.clear();
+        in.str(encoded);
+        benchmark::DoNotOptimize(frame.read(in));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CborRead);
+
+// How the frame writer encodes a frame : straight from the text, with no cbor tree.
+void BM_CborEncoderFrame(benchmark::State& state) {
+    cbor::encoder encoder;
+    std::string xml(status_xml);
+    for (auto _ : state) {
+        encoder.clear();
+        encoder.write_embedded_string(xml.data(), xml.size());
+        benchmark::DoNotOptimize(encoder.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CborEncoderFrame);
+
+void BM_FormatStatus(benchmark::State& state) {
+    Driver driver("radio1", schema_file, std_params_file);
+    driver.Load(Schema());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(driver.FormatStatus("Frequency", "Integer", "22917").data());
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatStatus);
+
+// Baseline : the status message as the driver formatted it before MessageTemplate.
+void BM_FormatRegex(benchmark::State& state) {
+    Driver driver("radio1", schema_file, std_params_file);
+    driver.Load(Schema());
+    const std::string format = driver.GetStatusMsgFormat();
+    for (auto _ : state) {
+        std::string msg = std::regex_replace(format, std::regex("_paramname_"), "Frequency");
+        msg = std::regex_replace(msg, std::regex("_paramtype_"), "Integer");
+        msg = std::regex_replace(msg, std::regex("_paramvalue_"), "22917");
+        benchmark::DoNotOptimize(msg.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatRegex);
+
+// What GetParamDetails did before RBMessage : parse into a property tree and walk <Control>.
+void ParsePropertyTree(const DeviceSchema& schema, const std::string& msg, std::string& category,
+                       std::string& name, std::string& type, std::string& value) {
+
+    boost::property_tree::ptree tree;
+    std::istringstream in(msg);
+    boost::property_tree::read_xml(in, tree);
+    for (const auto& v : tree.get_child("Control")) {
+        if (v.first == "Param") {
+            name = v.second.data();
+            ParamId id = schema.params.Find(name);
+            if (id != NO_PARAM && schema.params.Type(id) != ParamType::None) {
+                category = "CONTROL";
+                type = schema.params.TypeName(id);
+            } else if (name == "SendParameters" || name == "Reset" || name == "PowerOff") {
+                category = "REFCONTROL";
+                type = "EMPTY";
+            }
+        } else if (v.first == type && category == "CONTROL") {
+            value = v.second.data();
+        }
+    }
+}
+
+void BM_GetParamDetails(benchmark::State& state) {
+    Driver driver("radio1", schema_file, std_params_file);
+    driver.Load(Schema());
+    const std::string& msg = control_messages[state.range(0)];
+    std::string category, name, type, value;
+
+    // The scanner must find what the XML parser finds, there is no other check of it.
+    std::string tree_category, tree_name, tree_type, tree_value;
+    driver.GetParamDetails(msg, category, name, type, value);
+    ParsePropertyTree(*Schema(), msg, tree_category, tree_name, tree_type, tree_value);
+    if (category != tree_category || name != tree_name || type != tree_type || value != tree_value) {
+        state.SkipWithError("RBMessage and the property tree disagree on the message");
+        return;
+    }
+
+    for (auto _ : state) {
+        driver.GetParamDetails(msg, category, name, type, value);
+        benchmark::DoNotOptimize(value.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetParamDetails)->DenseRange(0, 3);
+
+// Baseline : a control message as GetParamDetails parsed it before RBMessage.
+void BM_ParsePropertyTree(benchmark::State& state) {
+    const std::string& msg = control_messages[state.range(0)];
+    std::string category, name, type, value;
+    for (auto _ : state) {
+        ParsePropertyTree(*Schema(), msg, category, name, type, value);
+        benchmark::DoNotOptimize(value.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParsePropertyTree)->DenseRange(0, 3);
+
+// Store a /status response with one changed value and send the change to RB.
+void BM_StoreAndSendStatus(benchmark::State& state) {
+    boost::asio::io_context ioc;
+    FrameWriter writer(ioc, std::chrono::milliseconds(0), 64 * 1024, NullOutput());
+    Driver driver("radio1", schema_file, std_params_file);
+    driver.Load(Schema());
+    driver.SetFrameWriter(&writer);
+
+    const std::string responses[2] = {
+        "{\"VSWR\":\"50\",\"PowerSupplyVoltage\":\"200\",\"PowerSupplyConsumption\":\"50000\","
+        "\"Temperature\":\"100\",\"SignalLevel\":\"5\"}",
+        "{\"VSWR\":\"50\",\"PowerSupplyVoltage\":\"200\",\"PowerSupplyConsumption\":\"50000\","
+        "\"Temperature\":\"101\",\"SignalLevel\":\"5\"}",
+    };
+    std::size_t i = 0;
+    for (auto _ : state) {
+        DeviceSnapshot snapshot;
+        driver.StoreDeviceResponse(responses[i++ & 1], snapshot);
+        driver.SendStatus(false);
+        writer.Flush();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StoreAndSendStatus);
+
+// Start up with no schema image : parse the XML and save the image, as the first
+// driver started with a schema does.
+void BM_SchemaColdStart(benchmark::State& state) {
+    std::uint64_t key;
+    SchemaCache::Key(schema_file, std_params_file, key);
+    std::string path = SchemaCache::ImagePath(cache_dir, key);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::remove(path.c_str());
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(SchemaCache::Load(cache_dir, schema_file, std_params_file));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SchemaColdStart)->Unit(benchmark::kMicrosecond);
+
+// Start up with the image of the schema there : hash the XML files and map the image in.
+void BM_SchemaWarmStart(benchmark::State& state) {
+    SchemaCache::Load(cache_dir, schema_file, std_params_file);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(SchemaCache::Load(cache_dir, schema_file, std_params_file));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SchemaWarmStart)->Unit(benchmark::kMicrosecond);
+
+#ifdef DRIVER_DEVICE_PROFILES
+// Start up with the profile compiled in : hash the XML files and build the schema from
+// the generated tables.
+void BM_SchemaProfileStart(benchmark::State& state) {
+    const std::vector<CompiledSchema> compiled = {CompiledSchemaOf<IsodeRadioProfile>()};
+    for (auto _ : state)
+        benchmark::DoNotOptimize(SchemaCache::Load("", schema_file, std_params_file, compiled));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SchemaProfileStart)->Unit(benchmark::kMicrosecond);
+#endif
+
+// A monitor tick of one device : fetch its status params from the mock device over a
+// kept-alive connection, then report the alert, the change and the operational status.
+void BM_MonitorTick(benchmark::State& state) {
+    boost::asio::io_context ioc;
+    MockDevice device(ioc);
+    HTTPConnectionPool pool(ioc, "127.0.0.1", std::to_string(device.Port()));
+    FrameWriter writer(ioc, std::chrono::milliseconds(0), 64 * 1024, NullOutput());
+    IsodeRadioDriver driver(ioc, pool, writer, "127.0.0.1", std::to_string(device.Port()), "radio1",
+                            schema_file, std_params_file);
+    driver.Load(Schema());
+
+    const std::string target("/device/radio1/status");
+    unsigned long long temperature = 100;
+    bool failed = false;
+    for (auto _ : state) {
+        device.Set("radio1", "Temperature", std::to_string(temperature++ % 50 + 100));
+
+        bool done = false;
+        driver.HTTPGet(target, [&](const DeviceSnapshot& snapshot) {
+            failed |= !snapshot.valid;
+            driver.SendAlert(snapshot);
+            driver.ReportStatusToRB(false, snapshot);
+            done = true;
+        });
+        while (!done)
+            ioc.run_one();
+        ioc.poll();
+    }
+    if (failed)
+        state.SkipWithError("The mock device did not answer");
+    state.SetItemsProcessed(state.iterations());
+    state.counters["connections"] = static_cast<double>(pool.GetConnectCount());
+}
+BENCHMARK(BM_MonitorTick)->UseRealTime();
+
+}
+
+int main(int argc, char** argv) {
+
+    // The driver logs to the console when logging is not set up, keep that out of the results.
+    boost::log::core::get()->set_logging_enabled(false);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,380 @@
+// Load generator for sizing driver deployments. Stands up N mock radios in this process,
+// runs the driver against them as a child process, feeds it control messages at a fixed
+// rate on its stdin as Red/Black would, and reads the status frames it writes back.
+//
+// Reports the latency from a control message to the status frame confirming the new value,
+// the status frames the driver sends, and the CPU it uses per device.
+//
+// Usage : driver-load [--devices <n>] [--duration <seconds>] [--control_rate <per second>]
+//                     [--latency <ms>] [--jitter <ms>] [--churn <probability>] [--poll_interval <ms>]
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/program_options.hpp>
+
+#include "../cbor11.h"
+#include "../perf_stats.h"
+#include "../rb_message.h"
+#include "mock_device.h"
+
+namespace net = boost::asio;
+namespace po = boost::program_options;
+
+namespace {
+
+// The text of a frame from the driver : tag 24 around a byte string holding the encoded text.
+std::string FrameText(const cbor::view& frame) {
+
+    cbor::reader reader(frame.data(), frame.size());
+    cbor::reader::item item;
+    while (reader.next(item) == cbor::reader::STATUS_OK) {
+        if (item.type == cbor::TYPE_BINARY && !item.indefinite)
+            reader = cbor::reader(item.bytes.data(), item.bytes.size());
+        else if (item.type == cbor::TYPE_STRING && !item.indefinite)
+            return std::string(item.bytes.chars(), item.bytes.size());
+        else if (item.type != cbor::TYPE_TAGGED)
+            break;
+    }
+    return std::string();
+}
+
+struct LoadOptions {
+    std::string driver;
+    unsigned int devices;
+    unsigned int duration;        // Seconds
+    double control_rate;          // Control messages per second, over all devices
+    unsigned int latency;         // Milliseconds
+    unsigned int jitter;          // Milliseconds
+    double churn;                 // Probability of a status param changing each second
+    unsigned int poll_interval;   // Milliseconds
+};
+
+class LoadTest {
+
+    private:
+    typedef std::chrono::steady_clock::time_point time_point;
+
+    struct Pending {
+        std::string value;
+        time_point sent;
+    };
+
+    net::io_context& ioc;
+    const LoadOptions& options;
+    MockDevice device;
+    std::vector<std::string> names;
+    std::string device_list;                 // File naming the devices for the driver
+
+    pid_t driver_pid;
+    net::posix::stream_descriptor to_driver;
+    net::posix::stream_descriptor from_driver;
+
+    cbor::encoder queued;                    // Control frames waiting to be written
+    std::vector<unsigned char> writing;      // Control frames being written
+    cbor::decoder frames;                    // Frames read from the driver
+
+    net::steady_timer control_timer;
+    net::steady_timer end_timer;
+    time_point started;
+    time_point next_control;
+    unsigned long long control_seq;
+
+    // Values of Frequency sent to each device and not confirmed yet, oldest first.
+    std::map<std::string, std::deque<Pending>> pending;
+    LatencyHistogram control_latency;
+
+    unsigned long long controls_sent;
+    unsigned long long controls_confirmed;
+    unsigned long long controls_superseded;  // Replaced by a later value before the driver wrote them
+    unsigned long long status_frames;
+    unsigned long long heartbeats;
+
+    bool SpawnDriver(void);
+    void ScheduleControl(void);
+    void SendControl(void);
+    void Write(void);
+    void Read(void);
+    void Received(const std::string& msg);
+
+    public:
+
+    LoadTest(net::io_context& ioc, const LoadOptions& options);
+    ~LoadTest();
+
+    // Run the test and print the report. Returns false if the driver could not be run.
+    bool Run(void);
+};
+
+LoadTest :: LoadTest(net::io_context& arg_ioc, const LoadOptions& arg_options)
+            : ioc(arg_ioc), options(arg_options), device(arg_ioc), driver_pid(-1),
+              to_driver(arg_ioc), from_driver(arg_ioc), control_timer(arg_ioc), end_timer(arg_ioc),
+              control_seq(0), controls_sent(0), controls_confirmed(0), controls_superseded(0),
+              status_frames(0), heartbeats(0) {
+
+    device_list = "/tmp/driver-load-" + std::to_string(::getpid()) + ".txt";
+    std::ofstream list(device_list);
+    for (unsigned int i = 0; i < options.devices; i++) {
+        names.push_back("radio" + std::to_string(i + 1));
+        device.AddRadio(names.back());
+        list << names.back() << "\n";
+    }
+
+    device.SetLatency(std::chrono::milliseconds(options.latency), std::chrono::milliseconds(options.jitter));
+    if (options.churn > 0)
+        device.StartChurn(std::chrono::seconds(1), options.churn);
+}
+
+LoadTest :: ~LoadTest() {
+    std::remove(device_list.c_str());
+}
+
+bool LoadTest :: SpawnDriver(void) {
+
+    int in[2], out[2];
+    if (::pipe(in) != 0 || ::pipe(out) != 0)
+        return false;
+
+    std::string poll_interval = std::to_string(options.poll_interval);
+    std::vector<std::string> args = {
+        options.driver, "--host", "127.0.0.1", "--port", std::to_string(device.Port()),
+        "--device_list", device_list,
+        "--schema_file", DRIVER_SOURCE_DIR "/isode-radio.xml",
+        "--std_params_file", DRIVER_SOURCE_DIR "/stdparams.xml",
+        "--poll_interval", poll_interval, "--status_poll_interval", poll_interval,
+        "--log_level", "warning", "--stats_interval", "0",
+    };
+
+    driver_pid = ::fork();
+    if (driver_pid < 0)
+        return false;
+
+    if (driver_pid == 0) {
+        ::dup2(in[0], STDIN_FILENO);
+        ::dup2(out[1], STDOUT_FILENO);
+        ::close(in[0]);
+        ::close(in[1]);
+        ::close(out[0]);
+        ::close(out[1]);
+
+        std::vector<char*> argv;
+        for (auto& arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        ::execv(argv[0], argv.data());
+        std::perror(argv[0]);
+        ::_exit(127);
+    }
+
+    ::close(in[0]);
+    ::close(out[1]);
+    to_driver.assign(in[1]);
+    from_driver.assign(out[0]);
+    return true;
+}
+
+void LoadTest :: ScheduleControl(void) {
+
+    // Keep to the rate on average, however late the timer fires.
+    next_control += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(1.0 / options.control_rate));
+    control_timer.expires_at(next_control);
+    control_timer.async_wait([this](boost::system::error_code ec) {
+        if (ec)
+            return;
+        SendControl();
+        ScheduleControl();
+    });
+}
+
+void LoadTest :: SendControl(void) {
+
+    // Set the Frequency of the devices in turn, to a value not sent to the device before.
+    const std::string& name = names[control_seq % names.size()];
+    std::string value = std::to_string(3000 + control_seq / names.size() % 27000);
+    control_seq++;
+
+    std::string msg = "<Control><Device>" + name + "</Device><DeviceType>IsodeRadio</DeviceType>"
+                      "<Param>Frequency</Param><Integer>" + value + "</Integer></Control>";
+    queued.write_embedded_string(msg.data(), msg.size());
+    pending[name].push_back(Pending{value, std::chrono::steady_clock::now()});
+    controls_sent++;
+    Write();
+}
+
+void LoadTest :: Write(void) {
+
+    if (!writing.empty() || queued.size() == 0)
+        return;
+
+    writing.assign(queued.data(), queued.data() + queued.size());
+    queued.clear();
+    net::async_write(to_driver, net::buffer(writing), [this](boost::system::error_code ec, std::size_t) {
+        writing.clear();
+        if (!ec)
+            Write();
+    });
+}
+
+void LoadTest :: Read(void) {
+
+    from_driver.async_read_some(net::buffer(frames.prepare(4096), 4096),
+                                [this](boost::system::error_code ec, std::size_t n) {
+        // The driver has exited, so stop the mock radios too.
+        if (ec) {
+            ioc.stop();
+            return;
+        }
+        frames.commit(n);
+
+        cbor::view frame;
+        while (frames.next(frame) == cbor::reader::STATUS_OK)
+            Received(FrameText(frame));
+        Read();
+    });
+}
+
+void LoadTest :: Received(const std::string& msg) {
+
+    RBMessage status;
+    if (!status.Scan(msg) || status.root != "Status")
+        return;
+    if (status.param == "Heartbeat") {
+        heartbeats++;
+        return;
+    }
+    status_frames++;
+    if (status.param != "Frequency")
+        return;
+
+    // A confirmed value settles the values sent before it, which the driver replaced
+    // with later ones before writing them to the device.
+    auto it = pending.find(std::string(status.device));
+    if (it == pending.end())
+        return;
+    std::deque<Pending>& sent = it->second;
+    for (std::size_t i = 0; i < sent.size(); i++) {
+        if (sent[i].value != status.value)
+            continue;
+        control_latency.Record(static_cast<uint64_t>(
+            std::chrono::nanoseconds(std::chrono::steady_clock::now() - sent[i].sent).count()));
+        controls_confirmed++;
+        controls_superseded += i;
+        sent.erase(sent.begin(), sent.begin() + i + 1);
+        return;
+    }
+}
+
+bool LoadTest :: Run(void) {
+
+    if (!SpawnDriver()) {
+        std::perror("driver-load");
+        return false;
+    }
+
+    started = std::chrono::steady_clock::now();
+    next_control = started;
+    Read();
+    if (options.control_rate > 0)
+        ScheduleControl();
+
+    // At the end, close the driver's stdin as RB would, and let it exit.
+    end_timer.expires_after(std::chrono::seconds(options.duration));
+    end_timer.async_wait([this](boost::system::error_code ec) {
+        if (ec)
+            return;
+        control_timer.cancel();
+        to_driver.close();
+    });
+
+    // Runs until the driver has exited and closed its stdout, see Read().
+    ioc.run();
+
+    int status;
+    struct rusage usage;
+    if (::wait4(driver_pid, &status, 0, &usage) != driver_pid)
+        return false;
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                 usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+
+    std::cout << "Devices : " << options.devices << ", duration : " << elapsed << " s"
+              << ", device latency : " << options.latency << " ms + up to " << options.jitter << " ms"
+              << ", churn : " << options.churn << "\n";
+    std::cout << "Control messages : sent " << controls_sent << ", confirmed " << controls_confirmed
+              << ", superseded " << controls_superseded << ", device POSTs " << device.GetPostCount() << "\n";
+    if (control_latency.Count() != 0) {
+        std::cout << "Control latency : p50 " << control_latency.Percentile(0.5) / 1e6
+                  << " ms, p90 " << control_latency.Percentile(0.9) / 1e6
+                  << " ms, p99 " << control_latency.Percentile(0.99) / 1e6
+                  << " ms, max " << control_latency.Max() / 1e6 << " ms\n";
+    }
+    std::cout << "Status frames : " << status_frames << ", " << status_frames / elapsed << " /s, "
+              << status_frames / elapsed / options.devices << " /s per device, heartbeats " << heartbeats << "\n";
+    std::cout << "Device requests : " << device.GetRequestCount() << ", "
+              << device.GetRequestCount() / elapsed << " /s\n";
+    std::cout << "Driver CPU : " << cpu << " s, " << cpu / elapsed * 100 << " % of a core, "
+              << cpu / elapsed * 100 / options.devices << " % per device, max RSS "
+              << usage.ru_maxrss / 1024 << " MiB\n";
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+    po::options_description desc("Usage : driver-load [options]\nOptions");
+    LoadOptions options;
+
+    desc.add_options ()
+    ("help", "Show this message")
+    ("driver", po::value<std::string>(&options.driver)->default_value(DRIVER_BINARY),
+                 "Driver executable")
+    ("devices", po::value<unsigned int>(&options.devices)->default_value(10),
+                 "Number of simulated radios")
+    ("duration", po::value<unsigned int>(&options.duration)->default_value(30),
+                 "Seconds to run for")
+    ("control_rate", po::value<double>(&options.control_rate)->default_value(10),
+                 "Control messages per second, over all devices")
+    ("latency", po::value<unsigned int>(&options.latency)->default_value(5),
+                 "Milliseconds the radios take to answer")
+    ("jitter", po::value<unsigned int>(&options.jitter)->default_value(5),
+                 "Up to this many more milliseconds, picked at random for each response")
+    ("churn", po::value<double>(&options.churn)->default_value(0.2),
+                 "Probability of each status param of each radio changing every second")
+    ("poll_interval", po::value<unsigned int>(&options.poll_interval)->default_value(1000),
+                 "Milliseconds between polls of the device status params by the driver");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch (po::error& e) {
+        std::cout << "ERROR: " << e.what() << "\n" << desc << "\n";
+        return 1;
+    }
+    if (vm.count("help") || options.devices == 0 || options.poll_interval == 0) {
+        std::cout << desc << "\n";
+        return 1;
+    }
+
+    net::io_context ioc;
+    LoadTest test(ioc, options);
+    return test.Run() ? 0 : 1;
+}
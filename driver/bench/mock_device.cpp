@@ -0,0 +1,221 @@
+#include "mock_device.h"
+
+#include <memory>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "../json_reader.h"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+
+using net::ip::tcp;
+
+// One keep-alive connection from the driver.
+class MockDevice::Session : public std::enable_shared_from_this<MockDevice::Session> {
+
+    private:
+    MockDevice& device;
+    beast::tcp_stream stream;
+    beast::flat_buffer buffer;
+    net::steady_timer delay_timer;
+    http::request<http::string_body> req;
+    http::response<http::string_body> res;
+
+    public:
+    Session(MockDevice& arg_device, tcp::socket socket)
+        : device(arg_device), stream(std::move(socket)), delay_timer(stream.get_executor()) {}
+
+    void Read(void) {
+        req = {};
+        http::async_read(stream, buffer, req, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            if (ec)
+                return;
+            self->Respond();
+        });
+    }
+
+    void Respond(void) {
+
+        device.request_count++;
+        res = {};
+        res.version(req.version());
+        res.keep_alive(req.keep_alive());
+        res.set(http::field::content_type, "application/json");
+
+        std::string target(req.target());
+        bool found;
+        if (req.method() == http::verb::post) {
+            device.post_count++;
+            found = device.Post(target, req.body());
+            res.body() = "Device parameters updated !\n";
+        } else {
+            found = device.Get(target, res.body());
+        }
+        res.result(found ? http::status::ok : http::status::not_found);
+        res.prepare_payload();
+
+        duration delay = device.ResponseDelay();
+        if (delay == duration::zero()) {
+            Write();
+            return;
+        }
+        delay_timer.expires_after(delay);
+        delay_timer.async_wait([self = shared_from_this()](beast::error_code ec) {
+            if (!ec)
+                self->Write();
+        });
+    }
+
+    void Write(void) {
+        http::async_write(stream, res, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            if (ec || !self->res.keep_alive())
+                return;
+            self->Read();
+        });
+    }
+};
+
+MockDevice :: MockDevice(net::io_context& ioc, unsigned short port)
+              : acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), port)),
+                latency(duration::zero()), jitter(duration::zero()),
+                churn_timer(ioc), churn_interval(duration::zero()), churn_probability(0),
+                request_count(0), post_count(0) {
+
+    // The params of the device simulator, see device/isode-device-web-manager.go.
+    initial = {
+        {"VSWR", "50"}, {"PowerSupplyVoltage", "200"}, {"PowerSupplyConsumption", "50000"},
+        {"Temperature", "100"}, {"SignalLevel", "5"}, {"Frequency", "12000"},
+        {"TransmissionPower", "10000"}, {"Enabled", "true"}, {"Modem", "Audio"},
+        {"DeviceType", "IsodeRadio"}, {"Status", "Operational"}, {"StartTime", "2021-06-03 17:34:40"},
+        {"Version", "1.0"}, {"DeviceTypeHash", "#ISODERADIO"}, {"UniqueID", "SAMPLE_RADIO_1"},
+        {"Alert", "Info"}, {"AlertMessage", "Parameters within limit."},
+    };
+    status_params = {"VSWR", "PowerSupplyVoltage", "PowerSupplyConsumption", "Temperature", "SignalLevel"};
+    ref_params = {"Status", "Version", "DeviceTypeHash", "UniqueID", "StartTime", "Alert", "AlertMessage"};
+
+    Accept();
+}
+
+void MockDevice :: Accept(void) {
+
+    acceptor.async_accept([this](beast::error_code ec, tcp::socket socket) {
+        if (ec)
+            return;
+        std::make_shared<Session>(*this, std::move(socket))->Read();
+        Accept();
+    });
+}
+
+void MockDevice :: SetLatency(duration arg_latency, duration arg_jitter) {
+    latency = arg_latency;
+    jitter = arg_jitter;
+}
+
+MockDevice::duration MockDevice :: ResponseDelay(void) {
+    if (jitter <= duration::zero())
+        return latency;
+    std::uniform_int_distribution<duration::rep> pick(0, jitter.count());
+    return latency + duration(pick(random));
+}
+
+MockDevice::Params& MockDevice :: Radio(const std::string& name) {
+    auto it = radios.find(name);
+    if (it == radios.end())
+        it = radios.emplace(name, initial).first;
+    return it->second;
+}
+
+bool MockDevice :: Get(const std::string& target, std::string& body) {
+
+    // /device/<name>[/<what>]
+    const std::string prefix("/device/");
+    if (target.compare(0, prefix.size(), prefix) != 0)
+        return false;
+    std::size_t slash = target.find('/', prefix.size());
+    Params& params = Radio(target.substr(prefix.size(), slash - prefix.size()));
+    if (slash == std::string::npos) {
+        body = ToJSON(params, nullptr);
+        return true;
+    }
+
+    std::string what = target.substr(slash + 1);
+    if (what == "status")
+        body = ToJSON(params, &status_params);
+    else if (what == "ref")
+        body = ToJSON(params, &ref_params);
+    else if (what == "reset" || what == "poweroff")
+        body = ToJSON(params, nullptr);
+    else
+        return false;
+    return true;
+}
+
+bool MockDevice :: Post(const std::string& target, const std::string& body) {
+
+    // /device/<name>/control
+    const std::string prefix("/device/");
+    const std::string suffix("/control");
+    if (target.size() <= prefix.size() + suffix.size() || target.compare(0, prefix.size(), prefix) != 0 ||
+        target.compare(target.size() - suffix.size(), suffix.size(), suffix) != 0)
+        return false;
+    Params& params = Radio(target.substr(prefix.size(), target.size() - prefix.size() - suffix.size()));
+
+    JSONObjectReader reader(body);
+    JSONObjectReader::Member member;
+    std::string key, value;
+    while (reader.Next(member)) {
+        if (!JSONObjectReader::Unescape(member.key, key) || !JSONObjectReader::Unescape(member.value, value))
+            return false;
+        params[key] = value;
+    }
+    return !reader.Failed();
+}
+
+void MockDevice :: StartChurn(duration interval, double probability) {
+    churn_interval = interval;
+    churn_probability = probability;
+    ScheduleChurn();
+}
+
+void MockDevice :: ScheduleChurn(void) {
+
+    churn_timer.expires_after(churn_interval);
+    churn_timer.async_wait([this](beast::error_code ec) {
+        if (ec)
+            return;
+
+        std::bernoulli_distribution changes(churn_probability);
+        std::uniform_int_distribution<int> step(-5, 5);
+        for (auto& radio : radios) {
+            for (const auto& name : status_params) {
+                if (changes(random))
+                    radio.second[name] = std::to_string(std::stoll(initial[name]) + step(random));
+            }
+        }
+        ScheduleChurn();
+    });
+}
+
+std::string MockDevice :: ToJSON(const Params& params, const std::vector<std::string>* names) {
+
+    // The values are plain text, none needs escaping.
+    std::string json("{");
+    auto append = [&json](const std::string& name, const std::string& value) {
+        if (json.size() > 1)
+            json += ',';
+        json += '"' + name + "\":\"" + value + '"';
+    };
+
+    if (names) {
+        for (const auto& name : *names)
+            append(name, params.at(name));
+    } else {
+        for (const auto& param : params)
+            append(param.first, param.second);
+    }
+    json += '}';
+    return json;
+}
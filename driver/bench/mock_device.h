@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+// HTTP radios for benchmarks and load tests, speaking the API of isode-device-web-manager :
+//
+//      GET  /device/<name>            all params
+//      GET  /device/<name>/status     device status params
+//      GET  /device/<name>/ref        referenced status params
+//      GET  /device/<name>/reset      /poweroff
+//      POST /device/<name>/control    set control params from a JSON object
+//
+// Each device name gets a radio of its own, with the params of the simulator, the first
+// time it is asked for. Responses can be delayed by a latency plus a random jitter, and
+// the status params of every radio can be made to change over time.
+//
+// Everything runs on the caller's io_context, so a benchmark can drive the mock and the
+// driver from one thread.
+class MockDevice {
+
+    public:
+    typedef std::chrono::steady_clock::duration duration;
+
+    private:
+    class Session;
+    typedef std::map<std::string, std::string> Params;
+
+    boost::asio::ip::tcp::acceptor acceptor;
+    std::map<std::string, Params> radios;        // Keyed by device name
+    Params initial;                              // Params of a new radio
+    std::vector<std::string> status_params;      // Params of /status
+    std::vector<std::string> ref_params;         // Params of /ref
+
+    duration latency;                            // Added to every response
+    duration jitter;                             // Upper bound of a random delay on top of the latency
+    boost::asio::steady_timer churn_timer;
+    duration churn_interval;
+    double churn_probability;
+    std::mt19937 random;
+
+    unsigned long long request_count;
+    unsigned long long post_count;
+
+    void Accept(void);
+
+    // The delay of the next response.
+    duration ResponseDelay(void);
+
+    Params& Radio(const std::string& name);
+
+    // Answer a request for 'target'. Returns false if there is no such target or the
+    // body of a POST is not a JSON object.
+    bool Get(const std::string& target, std::string& body);
+    bool Post(const std::string& target, const std::string& body);
+
+    void ScheduleChurn(void);
+
+    static std::string ToJSON(const Params& params, const std::vector<std::string>* names);
+
+    public:
+
+    // Listen on 127.0.0.1 at 'port', or at a free port with 0.
+    explicit MockDevice(boost::asio::io_context& ioc, unsigned short port = 0);
+
+    unsigned short Port(void) const { return acceptor.local_endpoint().port(); }
+
+    // Create a radio now rather than on its first request, so that it churns from the start.
+    void AddRadio(const std::string& name) { Radio(name); }
+
+    // Change the value of a param of a radio.
+    void Set(const std::string& device, const std::string& name, const std::string& value) {
+        Radio(device)[name] = value;
+    }
+    const std::string& Value(const std::string& device, const std::string& name) { return Radio(device)[name]; }
+
+    // Delay every response by 'latency' plus up to 'jitter', picked at random.
+    void SetLatency(duration latency, duration jitter);
+
+    // Every 'interval', change each status param of each radio with 'probability', by a
+    // few units around its initial value.
+    void StartChurn(duration interval, double probability);
+
+    unsigned long long GetRequestCount(void) const { return request_count; }
+    unsigned long long GetPostCount(void) const { return post_count; }
+};
@@ -2,7 +2,19 @@
 #include "cbor11.h"
 #include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <new>
 #include <sstream>
+struct cbor::tagged_t {
+	uint64_t tag;
+	cbor child;
+	tagged_t (uint64_t tag, const cbor &child) : tag (tag), child (child) {
+	}
+#if __cplusplus >= 201103
+	tagged_t (uint64_t tag, cbor &&child) : tag (tag), child (std::move (child)) {
+	}
+#endif
+};
 cbor::cbor (unsigned short value) : m_type (cbor::TYPE_UNSIGNED), m_value (value) {
 }
 cbor::cbor (unsigned value) : m_type (cbor::TYPE_UNSIGNED), m_value (value) {
@@ -27,13 +39,12 @@ cbor::cbor (const char *value) : m_type (cbor::TYPE_STRING), m_string (value) {
 }
 cbor::cbor (const cbor::array &value) : m_type (cbor::TYPE_ARRAY), m_array (value) {
 }
-cbor::cbor (const cbor::map &value) : m_type (cbor::TYPE_MAP), m_map (value) {
+cbor::cbor (const cbor::map &value) : m_type (cbor::TYPE_MAP), m_map (new cbor::map (value)) {
 }
 cbor cbor::tagged (unsigned long long tag, const cbor &value) {
 	cbor result;
 	result.m_type = cbor::TYPE_TAGGED;
-	result.m_value = tag;
-	result.m_array = cbor::array (1, value);
+	result.m_tagged = new cbor::tagged_t (tag, value);
 	return result;
 }
 cbor::cbor (cbor::simple value) : m_type (cbor::TYPE_SIMPLE), m_value (value & 255) {
@@ -47,7 +58,120 @@ cbor::cbor (double value) : m_type (cbor::TYPE_FLOAT), m_float (value) {
 #if __cplusplus >= 201103
 cbor::cbor (std::nullptr_t) : m_type (cbor::TYPE_SIMPLE), m_value (cbor::SIMPLE_NULL) {
 }
+cbor::cbor (cbor::binary &&value) : m_type (cbor::TYPE_BINARY), m_binary (std::move (value)) {
+}
+cbor::cbor (cbor::string &&value) : m_type (cbor::TYPE_STRING), m_string (std::move (value)) {
+}
+cbor::cbor (cbor::array &&value) : m_type (cbor::TYPE_ARRAY), m_array (std::move (value)) {
+}
+cbor::cbor (cbor::map &&value) : m_type (cbor::TYPE_MAP), m_map (new cbor::map (std::move (value))) {
+}
+cbor cbor::tagged (unsigned long long tag, cbor &&value) {
+	cbor result;
+	result.m_type = cbor::TYPE_TAGGED;
+	result.m_tagged = new cbor::tagged_t (tag, std::move (value));
+	return result;
+}
+// The moved from value is left undefined, which owns nothing.
+cbor::cbor (cbor &&other) : m_type (other.m_type), m_value (0) {
+	switch (other.m_type) {
+	case cbor::TYPE_BINARY:
+		new (&this->m_binary) cbor::binary (std::move (other.m_binary));
+		break;
+	case cbor::TYPE_STRING:
+		new (&this->m_string) cbor::string (std::move (other.m_string));
+		break;
+	case cbor::TYPE_ARRAY:
+		new (&this->m_array) cbor::array (std::move (other.m_array));
+		break;
+	case cbor::TYPE_MAP:
+		this->m_map = other.m_map;
+		break;
+	case cbor::TYPE_TAGGED:
+		this->m_tagged = other.m_tagged;
+		break;
+	default:
+		this->m_value = other.m_value;
+		return;
+	}
+	if (other.m_type == cbor::TYPE_MAP || other.m_type == cbor::TYPE_TAGGED) {
+		other.m_type = cbor::TYPE_SIMPLE;
+		other.m_value = cbor::SIMPLE_UNDEFINED;
+	} else {
+		other.destroy ();
+	}
+}
+cbor &cbor::operator = (cbor &&other) {
+	// Move out first, other may be part of this value.
+	if (this != &other) {
+		cbor temp (std::move (other));
+		this->destroy ();
+		new (this) cbor (std::move (temp));
+	}
+	return *this;
+}
 #endif
+cbor::cbor (const cbor &other) : m_type (other.m_type), m_value (0) {
+	switch (other.m_type) {
+	case cbor::TYPE_BINARY:
+		new (&this->m_binary) cbor::binary (other.m_binary);
+		break;
+	case cbor::TYPE_STRING:
+		new (&this->m_string) cbor::string (other.m_string);
+		break;
+	case cbor::TYPE_ARRAY:
+		new (&this->m_array) cbor::array (other.m_array);
+		break;
+	case cbor::TYPE_MAP:
+		this->m_map = new cbor::map (*other.m_map);
+		break;
+	case cbor::TYPE_TAGGED:
+		this->m_tagged = new cbor::tagged_t (*other.m_tagged);
+		break;
+	default:
+		this->m_value = other.m_value;
+		break;
+	}
+}
+cbor &cbor::operator = (const cbor &other) {
+	if (this != &other) {
+		cbor copy (other);
+		this->swap (copy);
+	}
+	return *this;
+}
+cbor::~cbor () {
+	this->destroy ();
+}
+void cbor::swap (cbor &other) {
+	cbor temp (std::move (other));
+	new (&other) cbor (std::move (*this));
+	new (this) cbor (std::move (temp));
+}
+// Release whatever the active member holds and become undefined.
+void cbor::destroy () {
+	switch (this->m_type) {
+	case cbor::TYPE_BINARY:
+		this->m_binary.~binary ();
+		break;
+	case cbor::TYPE_STRING:
+		this->m_string.~string ();
+		break;
+	case cbor::TYPE_ARRAY:
+		this->m_array.~array ();
+		break;
+	case cbor::TYPE_MAP:
+		delete this->m_map;
+		break;
+	case cbor::TYPE_TAGGED:
+		delete this->m_tagged;
+		break;
+	default:
+		break;
+	}
+	this->m_type = cbor::TYPE_SIMPLE;
+	this->m_value = cbor::SIMPLE_UNDEFINED;
+}
 bool cbor::is_unsigned () const {
 	return this->m_type == cbor::TYPE_UNSIGNED;
 }
@@ -97,7 +221,7 @@ uint64_t cbor::to_unsigned () const {
 	case cbor::TYPE_NEGATIVE:
 		return ~this->m_value;
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_unsigned ();
+		return this->m_tagged->child.to_unsigned ();
 	case cbor::TYPE_FLOAT:
 		return this->m_float;
 	default:
@@ -111,7 +235,7 @@ int64_t cbor::to_signed () const {
 	case cbor::TYPE_NEGATIVE:
 		return -1 - int64_t (this->m_value);
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_signed ();
+		return this->m_tagged->child.to_signed ();
 	case cbor::TYPE_FLOAT:
 		return this->m_float;
 	default:
@@ -119,77 +243,145 @@ int64_t cbor::to_signed () const {
 	}
 }
 cbor::binary cbor::to_binary () const {
+	return this->as_binary ();
+}
+cbor::string cbor::to_string () const {
+	return this->as_string ();
+}
+cbor::array cbor::to_array () const {
+	return this->as_array ();
+}
+cbor::map cbor::to_map () const {
+	return this->as_map ();
+}
+cbor::simple cbor::to_simple () const {
+	switch (this->m_type) {
+	case cbor::TYPE_TAGGED:
+		return this->m_tagged->child.to_simple ();
+	case cbor::TYPE_SIMPLE:
+		return cbor::simple (this->m_value);
+	default:
+		return cbor::SIMPLE_UNDEFINED;
+	}
+}
+bool cbor::to_bool () const {
+	switch (this->m_type) {
+	case cbor::TYPE_TAGGED:
+		return this->m_tagged->child.to_bool ();
+	case cbor::TYPE_SIMPLE:
+		return this->m_value == cbor::SIMPLE_TRUE;
+	default:
+		return false;
+	}
+}
+double cbor::to_float () const {
+	switch (this->m_type) {
+	case cbor::TYPE_UNSIGNED:
+		return double (this->m_value);
+	case cbor::TYPE_NEGATIVE:
+		return ldexp (-1 - int64_t (this->m_value >> 32), 32) + (-1 - int64_t (this->m_value << 32 >> 32));
+	case cbor::TYPE_TAGGED:
+		return this->m_tagged->child.to_float ();
+	case cbor::TYPE_FLOAT:
+		return this->m_float;
+	default:
+		return 0.0;
+	}
+}
+const cbor::binary &cbor::as_binary () const {
+	static const cbor::binary empty;
 	switch (this->m_type) {
 	case cbor::TYPE_BINARY:
 		return this->m_binary;
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_binary ();
+		return this->m_tagged->child.as_binary ();
+	default:
+		return empty;
+	}
+}
+cbor::binary cbor::take_binary () {
+	switch (this->m_type) {
+	case cbor::TYPE_BINARY: {
+		cbor::binary result;
+		result.swap (this->m_binary);
+		return result;
+	}
+	case cbor::TYPE_TAGGED:
+		return this->m_tagged->child.take_binary ();
 	default:
 		return cbor::binary ();
 	}
 }
-cbor::string cbor::to_string () const {
+const cbor::string &cbor::as_string () const {
+	static const cbor::string empty;
 	switch (this->m_type) {
 	case cbor::TYPE_STRING:
 		return this->m_string;
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_string ();
+		return this->m_tagged->child.as_string ();
 	default:
-		return cbor::string ();
+		return empty;
 	}
 }
-cbor::array cbor::to_array () const {
+cbor::string cbor::take_string () {
 	switch (this->m_type) {
-	case cbor::TYPE_ARRAY:
-		return this->m_array;
+	case cbor::TYPE_STRING: {
+		cbor::string result;
+		result.swap (this->m_string);
+		return result;
+	}
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_array ();
+		return this->m_tagged->child.take_string ();
 	default:
-		return cbor::array ();
+		return cbor::string ();
 	}
 }
-cbor::map cbor::to_map () const {
+const cbor::array &cbor::as_array () const {
+	static const cbor::array empty;
 	switch (this->m_type) {
-	case cbor::TYPE_MAP:
-		return this->m_map;
+	case cbor::TYPE_ARRAY:
+		return this->m_array;
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_map ();
+		return this->m_tagged->child.as_array ();
 	default:
-		return cbor::map ();
+		return empty;
 	}
 }
-cbor::simple cbor::to_simple () const {
+cbor::array cbor::take_array () {
 	switch (this->m_type) {
+	case cbor::TYPE_ARRAY: {
+		cbor::array result;
+		result.swap (this->m_array);
+		return result;
+	}
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_simple ();
-	case cbor::TYPE_SIMPLE:
-		return cbor::simple (this->m_value);
+		return this->m_tagged->child.take_array ();
 	default:
-		return cbor::SIMPLE_UNDEFINED;
+		return cbor::array ();
 	}
 }
-bool cbor::to_bool () const {
+const cbor::map &cbor::as_map () const {
+	static const cbor::map empty;
 	switch (this->m_type) {
+	case cbor::TYPE_MAP:
+		return *this->m_map;
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_bool ();
-	case cbor::TYPE_SIMPLE:
-		return this->m_value == cbor::SIMPLE_TRUE;
+		return this->m_tagged->child.as_map ();
 	default:
-		return false;
+		return empty;
 	}
 }
-double cbor::to_float () const {
+cbor::map cbor::take_map () {
 	switch (this->m_type) {
-	case cbor::TYPE_UNSIGNED:
-		return double (this->m_value);
-	case cbor::TYPE_NEGATIVE:
-		return ldexp (-1 - int64_t (this->m_value >> 32), 32) + (-1 - int64_t (this->m_value << 32 >> 32));
+	case cbor::TYPE_MAP: {
+		cbor::map result;
+		result.swap (*this->m_map);
+		return result;
+	}
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ().to_float ();
-	case cbor::TYPE_FLOAT:
-		return this->m_float;
+		return this->m_tagged->child.take_map ();
 	default:
-		return 0.0;
+		return cbor::map ();
 	}
 }
 cbor::operator unsigned short () const {
@@ -243,17 +435,21 @@ cbor::type_t cbor::type () const {
 uint64_t cbor::tag () const {
 	switch (this->m_type) {
 	case cbor::TYPE_TAGGED:
-		return this->m_value;
+		return this->m_tagged->tag;
 	default:
 		return 0;
 	}
 }
 cbor cbor::child () const {
+	return this->as_child ();
+}
+const cbor &cbor::as_child () const {
+	static const cbor undefined;
 	switch (this->m_type) {
 	case cbor::TYPE_TAGGED:
-		return this->m_array.front ();
+		return this->m_tagged->child;
 	default:
-		return cbor ();
+		return undefined;
 	}
 }
 bool cbor::operator < (const cbor &other) const {
@@ -271,15 +467,15 @@ bool cbor::operator < (const cbor &other) const {
 	case cbor::TYPE_ARRAY:
 		return this->m_array < other.m_array;
 	case cbor::TYPE_MAP:
-		return this->m_map < other.m_map;
+		return *this->m_map < *other.m_map;
 	case cbor::TYPE_TAGGED:
-		if (this->m_value < other.m_value) {
+		if (this->m_tagged->tag < other.m_tagged->tag) {
 			return true;
 		}
-		if (this->m_value > other.m_value) {
+		if (this->m_tagged->tag > other.m_tagged->tag) {
 			return false;
 		}
-		return this->m_array.front () < other.m_array.front ();
+		return this->m_tagged->child < other.m_tagged->child;
 	default:
 		return this->m_value < other.m_value;
 	}
@@ -296,12 +492,12 @@ bool cbor::operator == (const cbor &other) const {
 	case cbor::TYPE_ARRAY:
 		return this->m_array == other.m_array;
 	case cbor::TYPE_MAP:
-		return this->m_map == other.m_map;
+		return *this->m_map == *other.m_map;
 	case cbor::TYPE_TAGGED:
-		if (this->m_value != other.m_value) {
+		if (this->m_tagged->tag != other.m_tagged->tag) {
 			return false;
 		}
-		return this->m_array == other.m_array;
+		return this->m_tagged->child == other.m_tagged->child;
 	default:
 		return this->m_value == other.m_value;
 	}
@@ -359,7 +555,7 @@ bool cbor::read (std::istream &in) {
 			in.setstate (std::ios_base::failbit);
 			return false;
 		}
-		item.m_type = cbor::TYPE_BINARY;
+		item = cbor (cbor::binary ());
 		if (minor == 31) {
 			while (in.good () && in.peek () != 255) {
 				read_uint (in, major, minor, value);
@@ -383,7 +579,7 @@ bool cbor::read (std::istream &in) {
 			in.setstate (std::ios_base::failbit);
 			return false;
 		}
-		item.m_type = cbor::TYPE_STRING;
+		item = cbor (cbor::string ());
 		if (minor == 31) {
 			while (in.good () && in.peek () != 255) {
 				read_uint (in, major, minor, value);
@@ -407,19 +603,19 @@ bool cbor::read (std::istream &in) {
 			in.setstate (std::ios_base::failbit);
 			return false;
 		}
-		item.m_type = cbor::TYPE_ARRAY;
+		item = cbor (cbor::array ());
 		if (minor == 31) {
 			while (in.good () && in.peek () != 255) {
 				cbor child;
 				child.read (in);
-				item.m_array.push_back (child);
+				item.m_array.push_back (std::move (child));
 			}
 			in.get ();
 		} else {
 			for (uint64_t i = 0; in.good () && i != value; ++i) {
 				cbor child;
 				child.read (in);
-				item.m_array.push_back (child);
+				item.m_array.push_back (std::move (child));
 			}
 		}
 		break;
@@ -428,13 +624,13 @@ bool cbor::read (std::istream &in) {
 			in.setstate (std::ios_base::failbit);
 			return false;
 		}
-		item.m_type = cbor::TYPE_MAP;
+		item = cbor (cbor::map ());
 		if (minor == 31) {
 			while (in.good () && in.peek () != 255) {
 				cbor key, value;
 				key.read (in);
 				value.read (in);
-				item.m_map.insert (std::make_pair (key, value));
+				item.m_map->insert (std::make_pair (std::move (key), std::move (value)));
 			}
 			in.get ();
 		} else {
@@ -442,7 +638,7 @@ bool cbor::read (std::istream &in) {
 				cbor key, value;
 				key.read (in);
 				value.read (in);
-				item.m_map.insert (std::make_pair (key, value));
+				item.m_map->insert (std::make_pair (std::move (key), std::move (value)));
 			}
 		}
 		break;
@@ -451,11 +647,9 @@ bool cbor::read (std::istream &in) {
 			in.setstate (std::ios_base::failbit);
 			return false;
 		}
-		item.m_type = cbor::TYPE_TAGGED;
-		item.m_value = value;
 		cbor child;
 		child.read (in);
-		item.m_array.push_back (child);
+		item = cbor::tagged (value, std::move (child));
 		break;
 	}
 	case 7:
@@ -516,7 +710,7 @@ bool cbor::read (std::istream &in) {
 		in.setstate (std::ios_base::failbit);
 		return false;
 	}
-	*this = item;
+	*this = std::move (item);
 	return true;
 }
 void write_uint8 (std::ostream &out, int major, uint64_t value) {
@@ -601,15 +795,15 @@ void cbor::write (std::ostream &out) const {
 		}
 		break;
 	case cbor::TYPE_MAP:
-		write_uint (out, 5, this->m_map.size ());
-		for (cbor::map::const_iterator it = this->m_map.begin (); it != this->m_map.end (); ++it) {
+		write_uint (out, 5, this->m_map->size ());
+		for (cbor::map::const_iterator it = this->m_map->begin (); it != this->m_map->end (); ++it) {
 			it->first.write (out);
 			it->second.write (out);
 		}
 		break;
 	case cbor::TYPE_TAGGED:
-		write_uint (out, 6, this->m_value);
-		this->m_array.front ().write (out);
+		write_uint (out, 6, this->m_tagged->tag);
+		this->m_tagged->child.write (out);
 		break;
 	case cbor::TYPE_SIMPLE:
 		write_uint8 (out, 7, this->m_value);
@@ -620,23 +814,21 @@ void cbor::write (std::ostream &out) const {
 	}
 }
 bool cbor::validate (const cbor::binary &in) {
-	std::istringstream buf1 (std::string (in.begin (), in.end ()));
-	cbor buf2;
-	return buf2.read (buf1) && buf1.peek () == EOF;
+	cbor::reader reader (in.empty () ? 0 : &in[0], in.size ());
+	return reader.skip () == cbor::reader::STATUS_OK && reader.remaining () == 0;
 }
 cbor cbor::decode (const cbor::binary &in) {
-	std::istringstream buf1 (std::string (in.begin (), in.end ()));
-	cbor buf2;
-	if (buf2.read (buf1) && buf1.peek () == EOF) {
-		return buf2;
+	cbor::reader reader (in.empty () ? 0 : &in[0], in.size ());
+	cbor item;
+	if (reader.read (item) == cbor::reader::STATUS_OK && reader.remaining () == 0) {
+		return item;
 	}
 	return cbor ();
 }
 cbor::binary cbor::encode (const cbor &in) {
-	std::ostringstream buf1;
-	in.write (buf1);
-	std::string buf2 = buf1.str ();
-	return cbor::binary (buf2.begin (), buf2.end ());
+	cbor::encoder out;
+	out.write (in);
+	return cbor::binary (out.data (), out.data () + out.size ());
 }
 cbor::string cbor::debug (const cbor &in) {
 	std::ostringstream out;
@@ -704,8 +896,8 @@ cbor::string cbor::debug (const cbor &in) {
 		break;
 	case cbor::TYPE_MAP:
 		out << "{";
-		for (cbor::map::const_iterator it = in.m_map.begin (); it != in.m_map.end (); ++it) {
-			if (it != in.m_map.begin ()) {
+		for (cbor::map::const_iterator it = in.m_map->begin (); it != in.m_map->end (); ++it) {
+			if (it != in.m_map->begin ()) {
 				out << ", ";
 			}
 			out << cbor::debug (it->first) << ": " << cbor::debug (it->second);
@@ -713,7 +905,7 @@ cbor::string cbor::debug (const cbor &in) {
 		out << "}";
 		break;
 	case cbor::TYPE_TAGGED:
-		out << in.m_value << "(" << cbor::debug (in.m_array.front ()) << ")";
+		out << in.m_tagged->tag << "(" << cbor::debug (in.m_tagged->child) << ")";
 		break;
 	case cbor::TYPE_SIMPLE:
 		switch (in.m_value) {
@@ -749,3 +941,450 @@ cbor::string cbor::debug (const cbor &in) {
 	}
 	return out.str ();
 }
+cbor::view::view () : m_data (0), m_size (0) {
+}
+cbor::view::view (const unsigned char *data, size_t size) : m_data (data), m_size (size) {
+}
+const unsigned char *cbor::view::data () const {
+	return this->m_data;
+}
+const char *cbor::view::chars () const {
+	return reinterpret_cast <const char *> (this->m_data);
+}
+size_t cbor::view::size () const {
+	return this->m_size;
+}
+bool cbor::view::empty () const {
+	return this->m_size == 0;
+}
+cbor::string cbor::view::to_string () const {
+	return cbor::string (this->chars (), this->m_size);
+}
+cbor::binary cbor::view::to_binary () const {
+	return cbor::binary (this->m_data, this->m_data + this->m_size);
+}
+// Deeper nesting than this is treated as invalid rather than recursed into.
+static const unsigned MAX_DEPTH = 256;
+static double half_to_double (uint64_t value) {
+	int sign = value >> 15;
+	int exponent = value >> 10 & 31;
+	int significand = value & 1023;
+	double result;
+	if (exponent == 31) {
+		result = significand ? NAN : INFINITY;
+	} else if (exponent == 0) {
+		result = ldexp (significand, -24);
+	} else {
+		result = ldexp (1024 | significand, exponent - 25);
+	}
+	return sign ? -result : result;
+}
+cbor::reader::reader (const void *data, size_t size) : m_data (static_cast <const unsigned char *> (data)), m_size (size), m_pos (0) {
+}
+cbor::reader::status_t cbor::reader::next (cbor::reader::item &out) {
+	if (this->m_pos == this->m_size) {
+		return cbor::reader::STATUS_INCOMPLETE;
+	}
+	int major = this->m_data[this->m_pos] >> 5;
+	int minor = this->m_data[this->m_pos] & 31;
+	size_t length = minor >= 24 && minor < 28 ? size_t (1) << (minor - 24) : 0;
+	if (minor > 27 && minor < 31) {
+		return cbor::reader::STATUS_INVALID;
+	}
+	if (this->m_size - this->m_pos - 1 < length) {
+		return cbor::reader::STATUS_INCOMPLETE;
+	}
+	uint64_t value = minor < 24 ? minor : 0;
+	for (size_t i = 0; i != length; ++i) {
+		value = value << 8 | this->m_data[this->m_pos + 1 + i];
+	}
+	this->m_pos += 1 + length;
+	
+	out.value = value;
+	out.number = 0;
+	out.indefinite = minor == 31;
+	out.bytes = cbor::view ();
+	switch (major) {
+	case 0:
+	case 1:
+	case 6:
+		if (out.indefinite) {
+			return cbor::reader::STATUS_INVALID;
+		}
+		out.type = major == 0 ? cbor::TYPE_UNSIGNED : major == 1 ? cbor::TYPE_NEGATIVE : cbor::TYPE_TAGGED;
+		break;
+	case 2:
+	case 3:
+		out.type = major == 2 ? cbor::TYPE_BINARY : cbor::TYPE_STRING;
+		if (out.indefinite) {
+			out.value = 0;
+		} else {
+			if (this->m_size - this->m_pos < value) {
+				return cbor::reader::STATUS_INCOMPLETE;
+			}
+			out.bytes = cbor::view (this->m_data + this->m_pos, value);
+			this->m_pos += value;
+		}
+		break;
+	case 4:
+	case 5:
+		out.type = major == 4 ? cbor::TYPE_ARRAY : cbor::TYPE_MAP;
+		if (out.indefinite) {
+			out.value = 0;
+		}
+		break;
+	case 7:
+		switch (minor) {
+		case 25:
+			out.type = cbor::TYPE_FLOAT;
+			out.number = half_to_double (value);
+			break;
+		case 26: {
+			uint32_t bits = value;
+			float f;
+			memcpy (&f, &bits, sizeof f);
+			out.type = cbor::TYPE_FLOAT;
+			out.number = f;
+			break;
+		}
+		case 27:
+			out.type = cbor::TYPE_FLOAT;
+			memcpy (&out.number, &value, sizeof out.number);
+			break;
+		case 31:
+			// A break outside an indefinite length item.
+			return cbor::reader::STATUS_INVALID;
+		default:
+			out.type = cbor::TYPE_SIMPLE;
+			break;
+		}
+		break;
+	}
+	return cbor::reader::STATUS_OK;
+}
+bool cbor::reader::next_break () {
+	if (this->m_pos != this->m_size && this->m_data[this->m_pos] == 255) {
+		++this->m_pos;
+		return true;
+	}
+	return false;
+}
+cbor::reader::status_t cbor::reader::skip () {
+	return this->walk (0, 0);
+}
+cbor::reader::status_t cbor::reader::read (cbor &out) {
+	return this->walk (0, &out);
+}
+size_t cbor::reader::offset () const {
+	return this->m_pos;
+}
+size_t cbor::reader::remaining () const {
+	return this->m_size - this->m_pos;
+}
+// Step over one complete data item, building it in 'out' unless that is null.
+cbor::reader::status_t cbor::reader::walk (unsigned depth, cbor *out) {
+	if (depth > MAX_DEPTH) {
+		return cbor::reader::STATUS_INVALID;
+	}
+	cbor::reader::item head;
+	cbor::reader::status_t status = this->next (head);
+	if (status != cbor::reader::STATUS_OK) {
+		return status;
+	}
+	switch (head.type) {
+	case cbor::TYPE_BINARY:
+	case cbor::TYPE_STRING: {
+		cbor::binary bytes;
+		cbor::string text;
+		if (out) {
+			if (head.type == cbor::TYPE_BINARY) {
+				bytes.assign (head.bytes.data (), head.bytes.data () + head.bytes.size ());
+			} else {
+				text.assign (head.bytes.chars (), head.bytes.size ());
+			}
+		}
+		while (head.indefinite && !this->next_break ()) {
+			cbor::reader::item chunk;
+			status = this->next (chunk);
+			if (status != cbor::reader::STATUS_OK) {
+				return status;
+			}
+			if (chunk.type != head.type || chunk.indefinite) {
+				return cbor::reader::STATUS_INVALID;
+			}
+			if (out) {
+				if (head.type == cbor::TYPE_BINARY) {
+					bytes.insert (bytes.end (), chunk.bytes.data (), chunk.bytes.data () + chunk.bytes.size ());
+				} else {
+					text.append (chunk.bytes.chars (), chunk.bytes.size ());
+				}
+			}
+		}
+		if (out) {
+			if (head.type == cbor::TYPE_BINARY) {
+				*out = cbor (std::move (bytes));
+			} else {
+				*out = cbor (std::move (text));
+			}
+		}
+		break;
+	}
+	case cbor::TYPE_ARRAY: {
+		cbor::array elements;
+		for (uint64_t i = 0; head.indefinite ? !this->next_break () : i != head.value; ++i) {
+			cbor child;
+			status = this->walk (depth + 1, out ? &child : 0);
+			if (status != cbor::reader::STATUS_OK) {
+				return status;
+			}
+			if (out) {
+				elements.push_back (std::move (child));
+			}
+		}
+		if (out) {
+			*out = cbor (std::move (elements));
+		}
+		break;
+	}
+	case cbor::TYPE_MAP: {
+		cbor::map entries;
+		for (uint64_t i = 0; head.indefinite ? !this->next_break () : i != head.value; ++i) {
+			cbor key, value;
+			status = this->walk (depth + 1, out ? &key : 0);
+			if (status == cbor::reader::STATUS_OK) {
+				status = this->walk (depth + 1, out ? &value : 0);
+			}
+			if (status != cbor::reader::STATUS_OK) {
+				return status;
+			}
+			if (out) {
+				entries.insert (std::make_pair (std::move (key), std::move (value)));
+			}
+		}
+		if (out) {
+			*out = cbor (std::move (entries));
+		}
+		break;
+	}
+	case cbor::TYPE_TAGGED: {
+		cbor child;
+		status = this->walk (depth + 1, out ? &child : 0);
+		if (status != cbor::reader::STATUS_OK) {
+			return status;
+		}
+		if (out) {
+			*out = cbor::tagged (head.value, std::move (child));
+		}
+		break;
+	}
+	case cbor::TYPE_FLOAT:
+		if (out) {
+			*out = cbor (head.number);
+		}
+		break;
+	default:
+		if (out) {
+			cbor item;
+			item.m_type = head.type;
+			item.m_value = head.value;
+			*out = item;
+		}
+		break;
+	}
+	return cbor::reader::STATUS_OK;
+}
+cbor::decoder::decoder (size_t max_size) : m_begin (0), m_end (0), m_max_size (max_size) {
+}
+unsigned char *cbor::decoder::prepare (size_t size) {
+	if (this->m_begin == this->m_end) {
+		this->m_begin = this->m_end = 0;
+	} else if (this->m_begin != 0 && this->m_buffer.size () - this->m_end < size) {
+		// Move the unconsumed tail to the front rather than grow the buffer.
+		memmove (&this->m_buffer[0], &this->m_buffer[this->m_begin], this->m_end - this->m_begin);
+		this->m_end -= this->m_begin;
+		this->m_begin = 0;
+	}
+	if (this->m_buffer.size () - this->m_end < size) {
+		this->m_buffer.resize (this->m_end + size);
+	}
+	return &this->m_buffer[this->m_end];
+}
+void cbor::decoder::commit (size_t size) {
+	this->m_end += size;
+}
+void cbor::decoder::feed (const void *data, size_t size) {
+	if (size) {
+		memcpy (this->prepare (size), data, size);
+		this->commit (size);
+	}
+}
+cbor::reader::status_t cbor::decoder::next (cbor::view &out) {
+	if (this->m_begin == this->m_end) {
+		return cbor::reader::STATUS_INCOMPLETE;
+	}
+	cbor::reader reader (&this->m_buffer[this->m_begin], this->m_end - this->m_begin);
+	cbor::reader::status_t status = reader.skip ();
+	if (status == cbor::reader::STATUS_INCOMPLETE && this->m_end - this->m_begin > this->m_max_size) {
+		status = cbor::reader::STATUS_INVALID;
+	}
+	if (status != cbor::reader::STATUS_OK) {
+		return status;
+	}
+	out = cbor::view (&this->m_buffer[this->m_begin], reader.offset ());
+	this->m_begin += reader.offset ();
+	return cbor::reader::STATUS_OK;
+}
+size_t cbor::decoder::size () const {
+	return this->m_end - this->m_begin;
+}
+void cbor::decoder::clear () {
+	this->m_begin = this->m_end = 0;
+}
+// Size of the head write_head () emits for a value.
+static size_t head_size (uint64_t value) {
+	if (value < 24) {
+		return 1;
+	} else if ((value >> 8) == 0) {
+		return 2;
+	} else if ((value >> 16) == 0) {
+		return 3;
+	} else if ((value >> 32) == 0) {
+		return 5;
+	}
+	return 9;
+}
+cbor::encoder::encoder () {
+}
+// Write the head of a data item with the shortest argument for the value.
+static unsigned char *put_head (unsigned char *out, int major, uint64_t value) {
+	size_t length = head_size (value) - 1;
+	switch (length) {
+	case 0:
+		*out = major << 5 | value;
+		return out + 1;
+	case 1:
+		*out = major << 5 | 24;
+		break;
+	case 2:
+		*out = major << 5 | 25;
+		break;
+	case 4:
+		*out = major << 5 | 26;
+		break;
+	default:
+		*out = major << 5 | 27;
+		break;
+	}
+	for (size_t i = length; i != 0; --i) {
+		out[i] = value & 255;
+		value >>= 8;
+	}
+	return out + 1 + length;
+}
+void cbor::encoder::write_head (int major, uint64_t value) {
+	size_t pos = this->m_buffer.size ();
+	this->m_buffer.resize (pos + head_size (value));
+	put_head (&this->m_buffer[pos], major, value);
+}
+void cbor::encoder::write (const cbor &item) {
+	switch (item.m_type) {
+	case cbor::TYPE_UNSIGNED:
+		this->write_head (0, item.m_value);
+		break;
+	case cbor::TYPE_NEGATIVE:
+		this->write_head (1, item.m_value);
+		break;
+	case cbor::TYPE_BINARY:
+		this->write_binary (item.m_binary.empty () ? 0 : &item.m_binary[0], item.m_binary.size ());
+		break;
+	case cbor::TYPE_STRING:
+		this->write_string (item.m_string.data (), item.m_string.size ());
+		break;
+	case cbor::TYPE_ARRAY:
+		this->write_array (item.m_array.size ());
+		for (cbor::array::const_iterator it = item.m_array.begin (); it != item.m_array.end (); ++it) {
+			this->write (*it);
+		}
+		break;
+	case cbor::TYPE_MAP:
+		this->write_map (item.m_map->size ());
+		for (cbor::map::const_iterator it = item.m_map->begin (); it != item.m_map->end (); ++it) {
+			this->write (it->first);
+			this->write (it->second);
+		}
+		break;
+	case cbor::TYPE_TAGGED:
+		this->write_tag (item.m_tagged->tag);
+		this->write (item.m_tagged->child);
+		break;
+	case cbor::TYPE_SIMPLE:
+		// Simple values are always written with a one byte argument, as cbor::write does.
+		if (item.m_value < 24) {
+			this->m_buffer.push_back (7 << 5 | item.m_value);
+		} else {
+			this->m_buffer.push_back (7 << 5 | 24);
+			this->m_buffer.push_back (item.m_value);
+		}
+		break;
+	case cbor::TYPE_FLOAT:
+		if (double (float (item.m_float)) == item.m_float) {
+			float f = item.m_float;
+			uint32_t bits;
+			memcpy (&bits, &f, sizeof bits);
+			this->m_buffer.push_back (7 << 5 | 26);
+			for (int shift = 24; shift >= 0; shift -= 8) {
+				this->m_buffer.push_back (bits >> shift);
+			}
+		} else {
+			uint64_t bits;
+			memcpy (&bits, &item.m_float, sizeof bits);
+			this->m_buffer.push_back (7 << 5 | 27);
+			for (int shift = 56; shift >= 0; shift -= 8) {
+				this->m_buffer.push_back (bits >> shift);
+			}
+		}
+		break;
+	}
+}
+void cbor::encoder::write_unsigned (uint64_t value) {
+	this->write_head (0, value);
+}
+void cbor::encoder::write_binary (const void *data, size_t size) {
+	this->write_head (2, size);
+	const unsigned char *bytes = static_cast <const unsigned char *> (data);
+	this->m_buffer.insert (this->m_buffer.end (), bytes, bytes + size);
+}
+void cbor::encoder::write_string (const char *data, size_t size) {
+	this->write_head (3, size);
+	this->m_buffer.insert (this->m_buffer.end (), data, data + size);
+}
+void cbor::encoder::write_array (size_t size) {
+	this->write_head (4, size);
+}
+void cbor::encoder::write_map (size_t size) {
+	this->write_head (5, size);
+}
+void cbor::encoder::write_tag (uint64_t tag) {
+	this->write_head (6, tag);
+}
+void cbor::encoder::write_embedded_string (const char *data, size_t size) {
+	size_t embedded = head_size (size) + size;
+	size_t pos = this->m_buffer.size ();
+	this->m_buffer.resize (pos + 2 + head_size (embedded) + embedded);
+	unsigned char *out = &this->m_buffer[pos];
+	out = put_head (out, 6, 24);
+	out = put_head (out, 2, embedded);
+	out = put_head (out, 3, size);
+	if (size) {
+		memcpy (out, data, size);
+	}
+}
+const unsigned char *cbor::encoder::data () const {
+	return this->m_buffer.empty () ? 0 : &this->m_buffer[0];
+}
+size_t cbor::encoder::size () const {
+	return this->m_buffer.size ();
+}
+void cbor::encoder::clear () {
+	this->m_buffer.clear ();
+}
@@ -3,9 +3,11 @@
 //#if __cplusplus < 201103
 //#warning "To enable all features you must compile with -std=c++11"
 //#endif
+#include <cstddef>
 #include <iostream>
 #include <map>
 #include <stdint.h>
+#include <string>
 #include <vector>
 #if __cplusplus >= 201103
 #include <initializer_list>
@@ -35,6 +37,10 @@ public:
 		null = SIMPLE_NULL,
 		undefined = SIMPLE_UNDEFINED
 	};
+	class view;
+	class reader;
+	class decoder;
+	class encoder;
 	
 	cbor (unsigned short value);
 	cbor (unsigned value);
@@ -56,7 +62,18 @@ public:
 	cbor (double value);
 #if __cplusplus >= 201103
 	cbor (std::nullptr_t);
+	cbor (cbor::binary &&value);
+	cbor (cbor::string &&value);
+	cbor (cbor::array &&value);
+	cbor (cbor::map &&value);
+	static cbor tagged (unsigned long long tag, cbor &&value);
+	cbor (cbor &&other);
+	cbor &operator = (cbor &&other);
 #endif
+	cbor (const cbor &other);
+	cbor &operator = (const cbor &other);
+	~cbor ();
+	void swap (cbor &other);
 	
 	bool is_unsigned () const;
 	bool is_signed () const;
@@ -83,6 +100,19 @@ public:
 	bool to_bool () const;
 	double to_float () const;
 	
+	// The contents without a copy. Like the to_ functions these look through tags,
+	// and return an empty container for a value of another type.
+	const cbor::binary &as_binary () const;
+	const cbor::string &as_string () const;
+	const cbor::array &as_array () const;
+	const cbor::map &as_map () const;
+	
+	// Move the contents out, leaving an empty container of the same type behind.
+	cbor::binary take_binary ();
+	cbor::string take_string ();
+	cbor::array take_array ();
+	cbor::map take_map ();
+	
 	operator unsigned short () const;
 	operator unsigned () const;
 	operator unsigned long () const;
@@ -101,6 +131,7 @@ public:
 	
 	uint64_t tag () const;
 	cbor child () const;
+	const cbor &as_child () const;
 	
 	cbor::type_t type () const;
 	
@@ -117,13 +148,132 @@ public:
 	
 	bool operator < (const cbor &other) const;
 private:
+	struct tagged_t;
+	
+	void destroy ();
+	
+	// Only the member for m_type is alive. Strings and byte strings are kept in
+	// place, so short text needs no allocation, and the larger map and tagged
+	// values live on the heap to keep every node small.
 	cbor::type_t m_type;
 	union {
 		uint64_t m_value;
 		double m_float;
+		cbor::binary m_binary;
+		cbor::string m_string;
+		cbor::array m_array;
+		cbor::map *m_map;
+		tagged_t *m_tagged;
 	};
-	cbor::binary m_binary;
-	cbor::string m_string;
-	cbor::array m_array;
-	cbor::map m_map;
+};
+// A text or byte string inside a buffer being decoded. Does not own the bytes.
+class cbor::view {
+public:
+	view ();
+	view (const unsigned char *data, size_t size);
+	
+	const unsigned char *data () const;
+	const char *chars () const;
+	size_t size () const;
+	bool empty () const;
+	
+	cbor::string to_string () const;
+	cbor::binary to_binary () const;
+private:
+	const unsigned char *m_data;
+	size_t m_size;
+};
+// Decodes data items directly from a contiguous buffer. Strings are returned as
+// views into the buffer, so nothing is copied unless a cbor tree is asked for.
+// After any status other than STATUS_OK the position of the reader is unspecified.
+class cbor::reader {
+public:
+	enum status_t {
+		STATUS_OK,
+		STATUS_INCOMPLETE,
+		STATUS_INVALID
+	};
+	// The head of one data item. The elements of an array or map and the content
+	// of a tagged item follow as further items.
+	struct item {
+		cbor::type_t type;
+		uint64_t value;
+		double number;
+		bool indefinite;
+		cbor::view bytes;
+	};
+	
+	reader (const void *data, size_t size);
+	
+	// Read the head of the next data item. 'value' is the integer, tag, simple
+	// value or element count, 'number' the value of a float and 'bytes' the content
+	// of a definite length string. An indefinite string is followed by its chunks
+	// and an indefinite array or map by its elements, both ending at a break.
+	cbor::reader::status_t next (cbor::reader::item &out);
+	// Consume the break ending an indefinite length item if it is next.
+	bool next_break ();
+	
+	// Skip over, or decode, the next complete data item.
+	cbor::reader::status_t skip ();
+	cbor::reader::status_t read (cbor &out);
+	
+	size_t offset () const;
+	size_t remaining () const;
+private:
+	cbor::reader::status_t walk (unsigned depth, cbor *out);
+	
+	const unsigned char *m_data;
+	size_t m_size;
+	size_t m_pos;
+};
+// Splits a byte stream arriving in pieces, e.g. from a pipe, into complete data
+// items. Input is read straight into the decoder's buffer with prepare () and
+// commit (), and each complete item is handed out as a view of that buffer.
+class cbor::decoder {
+public:
+	explicit decoder (size_t max_size = 1024 * 1024);
+	
+	// Space for at least 'size' more bytes of input, invalidates earlier views.
+	unsigned char *prepare (size_t size);
+	void commit (size_t size);
+	void feed (const void *data, size_t size);
+	
+	// The encoding of the next complete data item, valid until the next call to
+	// prepare () or feed (). STATUS_INCOMPLETE until enough input has arrived;
+	// STATUS_INVALID for input that is not CBOR or an item larger than max_size.
+	cbor::reader::status_t next (cbor::view &out);
+	
+	size_t size () const;
+	void clear ();
+private:
+	std::vector <unsigned char> m_buffer;
+	size_t m_begin;
+	size_t m_end;
+	size_t m_max_size;
+};
+// Encodes data items into a buffer owned by the caller. clear () keeps the
+// capacity, so an encoder reused for every message stops allocating once it has
+// grown to the largest one.
+class cbor::encoder {
+public:
+	encoder ();
+	
+	void write (const cbor &item);
+	void write_unsigned (uint64_t value);
+	void write_binary (const void *data, size_t size);
+	void write_string (const char *data, size_t size);
+	void write_array (size_t size);
+	void write_map (size_t size);
+	void write_tag (uint64_t tag);
+	// Tag 24 around a byte string holding the encoding of a text string, written
+	// in one go without building a cbor tree.
+	void write_embedded_string (const char *data, size_t size);
+	
+	const unsigned char *data () const;
+	size_t size () const;
+	void clear ();
+private:
+	void write_head (int major, uint64_t value);
+	
+	std::vector <unsigned char> m_buffer;
 };
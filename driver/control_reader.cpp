@@ -0,0 +1,136 @@
+#include "control_reader.h"
+
+#include <cstdio>
+
+#include <boost/asio/post.hpp>
+#include <boost/utility/string_view.hpp>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace net = boost::asio;
+
+// Upper bound on buffered input that does not decode into a frame. Anything larger is
+// not a control message, so drop it rather than buffering forever.
+static const std::size_t MAX_PENDING = 1024 * 1024;
+
+// Size of each read from stdin.
+static const std::size_t READ_SIZE = 4096;
+
+bool ControlReader :: NextMessage(std::string& rb_msg) {
+
+    cbor::view frame;
+    switch (frames.next(frame)) {
+    case cbor::reader::STATUS_OK:
+        rb_msg = ControlMessage(frame);
+        return true;
+    case cbor::reader::STATUS_INVALID:
+        frames.clear();
+        return false;
+    default:
+        // Wait for the rest of the frame.
+        return false;
+    }
+}
+
+#if defined(BOOST_ASIO_HAS_POSIX_STREAM_DESCRIPTOR)
+
+ControlReader :: ControlReader(net::io_context& arg_ioc, MessageHandler arg_on_message, CloseHandler arg_on_close)
+                 : ioc(arg_ioc), on_message(arg_on_message), on_close(arg_on_close),
+                   frames(MAX_PENDING), input(arg_ioc, ::dup(STDIN_FILENO)) {
+
+}
+
+ControlReader :: ~ControlReader() {
+    boost::system::error_code ec;
+    input.close(ec);
+}
+
+void ControlReader :: Start(void) {
+    Read();
+}
+
+void ControlReader :: Read(void) {
+
+    input.async_read_some(net::buffer(frames.prepare(READ_SIZE), READ_SIZE),
+        [this](boost::system::error_code ec, std::size_t n) {
+            if (ec) {
+                if (ec != net::error::operation_aborted)
+                    on_close();
+                return;
+            }
+            frames.commit(n);
+            Dispatch();
+            Read();
+        });
+}
+
+void ControlReader :: Dispatch(void) {
+
+    std::string rb_msg;
+    while (NextMessage(rb_msg))
+        on_message(rb_msg);
+}
+
+#else
+
+ControlReader :: ControlReader(net::io_context& arg_ioc, MessageHandler arg_on_message, CloseHandler arg_on_close)
+                 : ioc(arg_ioc), on_message(arg_on_message), on_close(arg_on_close), frames(MAX_PENDING) {
+
+}
+
+ControlReader :: ~ControlReader() {
+
+}
+
+void ControlReader :: Start(void) {
+
+    // The thread blocks on stdin for the life of the process, so it is never joined.
+    reader = std::thread([this] {
+        while (true) {
+            int n = ::_read(_fileno(stdin), frames.prepare(READ_SIZE), static_cast<unsigned>(READ_SIZE));
+            if (n <= 0) {
+                net::post(ioc, on_close);
+                return;
+            }
+            frames.commit(static_cast<std::size_t>(n));
+
+            std::string rb_msg;
+            while (NextMessage(rb_msg))
+                net::post(ioc, [this, rb_msg] { on_message(rb_msg); });
+        }
+    });
+    reader.detach();
+}
+
+#endif
+
+std::string ControlReader :: ControlMessage(const cbor::view& frame) {
+
+    static const boost::string_view control_start("<Control");
+
+    // Frames are tag 24 around a byte string holding the encoded text of the message.
+    cbor::reader reader(frame.data(), frame.size());
+    cbor::reader::item item;
+    while (reader.next(item) == cbor::reader::STATUS_OK) {
+        if (item.type == cbor::TYPE_BINARY && !item.indefinite) {
+            reader = cbor::reader(item.bytes.data(), item.bytes.size());
+        } else if (item.type == cbor::TYPE_STRING && !item.indefinite) {
+            boost::string_view text(item.bytes.chars(), item.bytes.size());
+            std::size_t first = text.find(control_start);
+            if (first != boost::string_view::npos)
+                return std::string(text.substr(first));
+            break;
+        } else if (item.type != cbor::TYPE_TAGGED) {
+            break;
+        }
+    }
+
+    // Not the usual layout, look for the message in the raw frame.
+    boost::string_view raw(frame.chars(), frame.size());
+    std::size_t first = raw.find(control_start);
+    return first == boost::string_view::npos ? std::string() : std::string(raw.substr(first));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include "cbor11.h"
+
+// Reads the CBOR framed control messages Red/Black writes to the driver's stdin and
+// hands each one to a handler on the io_context. On POSIX systems stdin is read
+// asynchronously through a stream descriptor; elsewhere a reader thread does the
+// blocking reads and posts the messages to the io_context.
+class ControlReader {
+
+    public:
+    typedef std::function<void(const std::string&)> MessageHandler;
+    typedef std::function<void(void)> CloseHandler;
+
+    private:
+    boost::asio::io_context& ioc;
+    MessageHandler on_message;     // Called with each control message
+    CloseHandler on_close;         // Called once stdin is closed
+
+    cbor::decoder frames;          // Input is read straight into its buffer and split into frames there
+
+    // Take the control message out of the next complete frame. Returns false once no
+    // complete frame is buffered. Input that is not CBOR is dropped.
+    bool NextMessage(std::string& rb_msg);
+
+#if defined(BOOST_ASIO_HAS_POSIX_STREAM_DESCRIPTOR)
+    boost::asio::posix::stream_descriptor input;
+
+    void Read(void);
+
+    // Dispatch every complete frame read so far.
+    void Dispatch(void);
+#else
+    std::thread reader;
+#endif
+
+    public:
+
+    ControlReader(boost::asio::io_context& ioc, MessageHandler on_message, CloseHandler on_close);
+    ~ControlReader();
+
+    // Start reading stdin.
+    void Start(void);
+
+    // Extract the XML control message from the encoding of a CBOR frame, looking
+    // through tag 24 and the embedded CBOR byte strings without copying them.
+    static std::string ControlMessage(const cbor::view& frame);
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "driver.h"
+
+// A device profile is a DeviceSchema compiled into C++ at build time by
+// device-profile-gen (profile_gen.cpp) from an Abstract Device Specification and the
+// standard parameters. It holds the tables of the schema and nothing else, the driver
+// stores and sends values through the DeviceSchema as it does for a schema loaded from
+// the XML. E.g. for the Isode radio :
+//
+//      struct IsodeRadioProfile {
+//          static constexpr const char* name = "IsodeRadioProfile";
+//          static constexpr std::uint64_t key = ...;                 // SchemaCache::Key of the XML
+//          static constexpr const char* device_type = "IsodeRadio";
+//          static constexpr const char* device_family = "...";
+//          static constexpr ParamId heartbeat_id = ..., status_id = ..., alert_id = ..., alert_message_id = ...;
+//          static constexpr std::size_t param_count = ...;
+//          static const ProfileParam* params(void);                   // param_count of them
+//          static constexpr std::size_t tracked_count = ...;
+//          static const ParamId* tracked(void);
+//          static constexpr std::uint64_t seed = ...;               // Perfect hash of the registry
+//          static constexpr std::size_t slot_count = ...;
+//          static const ParamId* slots(void);
+//      };
+//
+// The arrays are static locals of inline functions rather than static constexpr members,
+// which before C++17 would each need a definition outside of the header.
+//
+// ProfileSchema<Profile>() turns the tables into a DeviceSchema without reading, parsing
+// or hashing anything. It is used through CompiledSchemaOf<Profile>() when the schema
+// files given at run time are the ones the profile was generated from, which SchemaCache
+// still hashes the files to find out. Any other device type falls back to the XML, see
+// SchemaCache::Load.
+
+enum ProfileParamFlags : std::uint8_t {
+    PROFILE_BOUNDED = 1,        // Both LowerBound and UpperBound were given
+    PROFILE_SKIP_STATUS = 2,    // Not sent as status, see DeviceSchema::skip_status
+};
+
+// One param of a profile, in ID order.
+struct ProfileParam {
+    const char* name;
+    ParamType type;
+    std::uint8_t flags;
+    long long lower;
+    long long upper;
+    long long multiplier;
+    const char* status_open;    // See DeviceSchema::status_open
+    const char* status_close;
+    std::size_t enum_count;
+    const char* enum_values;    // Each followed by a '\0'
+};
+
+template <class Profile>
+std::shared_ptr<const DeviceSchema> ProfileSchema(void) {
+
+    std::shared_ptr<DeviceSchema> schema = std::make_shared<DeviceSchema>();
+    schema->device_type = Profile::device_type;
+    schema->device_family = Profile::device_family;
+
+    std::vector<std::string> names(Profile::param_count);
+    std::vector<ParamType> types(Profile::param_count);
+    std::vector<ParamBounds> bounds(Profile::param_count);
+    schema->skip_status.assign(Profile::param_count, 0);
+    schema->status_open.resize(Profile::param_count);
+    schema->status_close.resize(Profile::param_count);
+    for (std::size_t id = 0; id < Profile::param_count; id++) {
+        const ProfileParam& param = Profile::params()[id];
+        names[id] = param.name;
+        types[id] = param.type;
+        bounds[id].bounded = (param.flags & PROFILE_BOUNDED) != 0;
+        bounds[id].lower = param.lower;
+        bounds[id].upper = param.upper;
+        bounds[id].multiplier = param.multiplier;
+        schema->skip_status[id] = (param.flags & PROFILE_SKIP_STATUS) != 0;
+        schema->status_open[id] = param.status_open;
+        schema->status_close[id] = param.status_close;
+    }
+
+    schema->tracked_params.assign(Profile::tracked(), Profile::tracked() + Profile::tracked_count);
+    schema->params.Restore(std::move(names), std::move(types), std::move(bounds),
+                           std::vector<ParamId>(Profile::slots(), Profile::slots() + Profile::slot_count), Profile::seed);
+    for (std::size_t id = 0; id < Profile::param_count; id++) {
+        const ProfileParam& param = Profile::params()[id];
+        std::vector<std::string> values;
+        for (const char* value = param.enum_values; values.size() < param.enum_count; value += values.back().size() + 1)
+            values.emplace_back(value);
+        schema->params.SetEnumValues(static_cast<ParamId>(id), std::move(values));
+    }
+    schema->heartbeat_id = Profile::heartbeat_id;
+    schema->status_id = Profile::status_id;
+    schema->alert_id = Profile::alert_id;
+    schema->alert_message_id = Profile::alert_message_id;
+    return schema;
+}
+
+template <class Profile>
+CompiledSchema CompiledSchemaOf(void) {
+    return CompiledSchema{Profile::name, Profile::key, &ProfileSchema<Profile>};
+}
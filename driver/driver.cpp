@@ -1,4 +1,7 @@
+#include <csignal>
+
 #include "driver.h"
+#include "schema_cache.h"
 
 namespace pt = boost::property_tree;
 namespace beast = boost::beast;
@@ -12,118 +15,59 @@ namespace src = boost::log::sources;
 using net::ip::tcp;
 using boost::property_tree::ptree;
 using boost::property_tree::write_json;
-using boost::property_tree::read_json;
-
-Driver :: Driver(std::string dev_name, std::string arg_schema_file, std::string arg_std_params_file) {
-
-    device_name = dev_name;
-    schema_file = arg_schema_file;
-    std_params_file = arg_std_params_file;
-
-    std::string param_types [] = {"Integer", "String", "Boolean",
-                                    "DateTime", "Enumerated", "AlertType"};
-    ptype.insert(param_types, param_types + sizeof(param_types)/sizeof(param_types[0]));
 
-    status_msg_format = "<Status><Device>" + dev_name + "</Device><DeviceType>_devicetype_</DeviceType><Param>_paramname_</Param><_paramtype_>_paramvalue_</_paramtype_></Status>\n";
-
-#ifdef _WIN32
-	setmode(fileno(stdout), O_BINARY);
-	setmode(fileno(stdin), O_BINARY);
-#endif
+const std::string& DeviceSchema :: GetParamType(const std::string& name) const {
+    ParamId id = params.Find(name);
+    return ParamTypeName(id == NO_PARAM ? ParamType::None : params.Type(id));
 }
 
-Driver :: ~Driver() {
+void DeviceSchema :: BuildStatusFragments (void) {
 
+    // Example : <Param>Frequency</Param><Integer> and </Integer></Status>, the value goes in between.
+    status_open.resize(params.Size());
+    status_close.resize(params.Size());
+    for (ParamId id = 0; id < params.Size(); id++) {
+        status_open[id] = "<Param>" + params.Name(id) + "</Param><" + params.TypeName(id) + ">";
+        status_close[id] = "</" + params.TypeName(id) + "></Status>\n";
+    }
 }
 
-std :: string Driver :: GetStatusMsgFormat(void) {
-    return status_msg_format;
-}
+namespace {
 
-std :: string Driver :: GetDeviceName(void) {
-    return device_name;
-}
+// Store the bounds given with the type of an Integer param, e.g.
+//      <Integer><LowerBound>10</LowerBound><UpperBound>100</UpperBound><Multiplier>10</Multiplier></Integer>
+void LoadBounds(ParamRegistry& params, ParamId id, const pt::ptree& type_tree) {
 
-std :: string Driver :: GetDeviceType(void) {
-    return device_type;
-}
+    auto lower = type_tree.get_optional<long long>("LowerBound");
+    auto upper = type_tree.get_optional<long long>("UpperBound");
+    if (!lower || !upper)
+        return;
 
-void Driver :: SendHeartBeat(int MONITOR_TIME) {
-    std::time_t time_now = std::time(nullptr);
-    std::string msg = status_msg_format;
-    msg = std::regex_replace(msg, std::regex("_paramname_"), "Heartbeat");
-    msg = std::regex_replace(msg, std::regex("_paramtype_"), param_name_type["Heartbeat"]);
-    msg = std::regex_replace(msg, std::regex("_paramvalue_"), std::to_string(time_now + MONITOR_TIME));
-    SendCBOR(msg);
+    ParamBounds range;
+    range.bounded = true;
+    range.lower = *lower;
+    range.upper = *upper;
+    range.multiplier = type_tree.get<long long>("Multiplier", 1);
+    params.SetBounds(id, range);
 }
 
-void Driver :: GetParamDetails (const std::string& rb_msg,
-                                std::string& param_category,
-                                std::string& param_name,
-                                std::string& param_type,
-                                std::string& param_value) {
-
-    using namespace logging::trivial;
-    src::severity_logger<severity_level> lg;
-
-    /*  Below is the example of a control message from RB server
-        <Control>
-            <Device>Radio</Device>
-            <DeviceType>IsodeRadio</DeviceType>
-            <Param>Frequency</Param>
-            <Integer>22917</Integer>
-        </Control>
-    */
-
-    // Create empty property tree object
-    pt::ptree param_tree;
-
-    try {
-        std :: stringstream ss;
-        ss << rb_msg;
-        read_xml(ss, param_tree);
-    } catch (pt::xml_parser_error &e) {
-        BOOST_LOG_SEV(lg, info) << "Failed to parse control xml message from RB. " << e.what();
-    } catch (...) {
-        BOOST_LOG_SEV(lg, info) << "Failed to read RB control message.";
-    }
-
-    for (auto& v : param_tree.get_child("Control")) {
-
-        std::string attr = v.first.data();
+// Store the values listed with the type of an Enumerated param, e.g.
+//      <Enumerated><EnumValue>Operational</EnumValue><EnumValue>Not Operational</EnumValue></Enumerated>
+void LoadEnumValues(ParamRegistry& params, ParamId id, const pt::ptree& type_tree) {
 
-        if (attr == "Param") {
-            param_name = v.second.data();
-            if (param_name_type.find(param_name) != param_name_type.end()) {
-                param_category = "CONTROL";
-                param_type = param_name_type[param_name];
-            } else if (param_name == "SendParameters" || param_name == "Reset" || param_name == "PowerOff") {
-                param_category = "REFCONTROL";
-                param_type = "EMPTY";
-            }
-        } else if (v.first.data() == param_type && param_category == "CONTROL") {
-            param_value = v.second.data();
-        }
+    std::vector<std::string> values;
+    for (auto& v : type_tree) {
+        if (v.first == "EnumValue")
+            values.push_back(v.second.data());
     }
+    if (!values.empty())
+        params.SetEnumValues(id, std::move(values));
 }
 
-void Driver :: InitLogging (void) {
+// Level of the alert raised by the driver for params beyond their range, as the device
+// simulator raises it.
+const std::string range_alert("Warning");
 
-    logging::add_file_log
-    (
-        keywords::file_name = "/tmp/" + device_name + "_%N.log",        /*< file name pattern >*/
-        keywords::rotation_size = 10 * 1024 * 1024,                                   /*< rotate files every 10 MiB... >*/
-        keywords::time_based_rotation = sinks::file::rotation_at_time_point(0, 0, 0), /*< ...or at midnight >*/
-        keywords::format = "[%TimeStamp%]: %Message%",                                /*< log record format >*/
-        keywords::auto_flush = true
-    );
-
-    logging::core::get()->set_filter
-    (
-        logging::trivial::severity >= logging::trivial::info
-    );
-
-    logging::add_common_attributes();
 }
 
 // Parse the device schema XML and standard parameters XML and do the below
@@ -131,24 +75,25 @@ void Driver :: InitLogging (void) {
 // 2. Extract the Reference Status & Reference Control Params
 // 3. Extract the Standard Parameters
 
-void Driver :: Load () {
+std::shared_ptr<const DeviceSchema> DeviceSchema :: Load (const std::string& schema_file,
+                                                          const std::string& std_params_file) {
 
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
+    std::shared_ptr<DeviceSchema> schema = std::make_shared<DeviceSchema>();
+
     // Create empty property tree object
     pt::ptree device_tree;
 
     // Parse the XML into the property tree.
     pt::read_xml(schema_file, device_tree);
 
-    device_type = device_tree.get<std::string>("AbstractDeviceSpecification.DeviceType");
-    device_family = device_tree.get<std::string>("AbstractDeviceSpecification.DeviceFamily");
+    schema->device_type = device_tree.get<std::string>("AbstractDeviceSpecification.DeviceType");
+    schema->device_family = device_tree.get<std::string>("AbstractDeviceSpecification.DeviceFamily");
 
-    status_msg_format = std::regex_replace(status_msg_format, std::regex("_devicetype_"), device_type);
-
-    BOOST_LOG_SEV(lg, info) << "Device Type : [" << device_type << "] Device Family : [" \
-        << device_family << "]";
+    BOOST_LOG_SEV(lg, info) << "Device Type : [" << schema->device_type << "] Device Family : [" \
+        << schema->device_family << "]";
 
     BOOST_LOG_SEV(lg, info) << "Fetching device status parameters from file [" << schema_file << "]";
 
@@ -158,18 +103,21 @@ void Driver :: Load () {
         std::string param_name("");
         for (auto& p : v.second) {
             std::string tag = p.first.data();
-            // Store the param and the value. Since we can't fetch the device status value at this stage
-            // set it to "".
+            // Store the param. Since we can't fetch the device status value at this stage
+            // the driver starts with the value "".
             if (tag == "ParameterName") {
-                param_name_val.insert(std::pair<std::string,std::string>(p.second.data(), ""));
-                found = true;
                 param_name = p.second.data();
+                schema->tracked_params.push_back(schema->params.Add(param_name));
+                found = true;
             }
             // If the next found tag is param_type (String, Integer, Boolean,...),
             // store the earlier found param and param type.
-            else if (found && ptype.find(tag) != ptype.end()) {
-                param_name_type.insert(std::pair<std::string,std::string>(param_name, tag));
-                BOOST_LOG_SEV(lg, info) << "Param [" << param_name << "], Type [" << tag << "]";
+            else if (found && ParseParamType(tag) != ParamType::None) {
+                ParamId id = schema->params.Add(param_name);
+                schema->params.SetType(id, ParseParamType(tag));
+                LoadBounds(schema->params, id, p.second);
+                LoadEnumValues(schema->params, id, p.second);
+                BOOST_LOG_SEV(lg, debug) << "Param [" << param_name << "], Type [" << tag << "]";
                 found = false;
             }
         }
@@ -183,27 +131,30 @@ void Driver :: Load () {
         std::string param_name("");
         for (auto& p : v.second) {
             std::string tag = p.first.data();
-            // Store the param and the value. Since we can't fetch the device status value at this stage
-            // set it to "".
+            // Store the param. Since we can't fetch the device status value at this stage
+            // the driver starts with the value "".
             if (tag == "ParameterName") {
-                param_name_val.insert(std::pair<std::string,std::string>(p.second.data(), ""));
-                found = true;
                 param_name = p.second.data();
+                schema->tracked_params.push_back(schema->params.Add(param_name));
+                found = true;
             }
             // If the next found tag is param_type (String, Integer, Boolean,...),
             // store the earlier found param and param type.
-            else if (found && ptype.find(tag) != ptype.end()) {
-                param_name_type.insert(std::pair<std::string,std::string>(param_name, tag));
-                BOOST_LOG_SEV(lg, info) << "Param [" << param_name << "], Type [" << tag << "]";
+            else if (found && ParseParamType(tag) != ParamType::None) {
+                ParamId id = schema->params.Add(param_name);
+                schema->params.SetType(id, ParseParamType(tag));
+                LoadBounds(schema->params, id, p.second);
+                LoadEnumValues(schema->params, id, p.second);
+                BOOST_LOG_SEV(lg, debug) << "Param [" << param_name << "], Type [" << tag << "]";
                 found = false;
             }
         }
     }
 
-    // Get list of referenced status params from the xml schema file and store the value as ""
-    // as no value could be fetched at this stage.
+    // Get list of referenced status params from the xml schema file, no value
+    // could be fetched at this stage either.
     for (auto& v : device_tree.get_child("AbstractDeviceSpecification.ReferencedStatusParameters")) {
-         param_name_val.insert(std::pair<std::string, std::string>(v.second.data(),""));
+        schema->tracked_params.push_back(schema->params.Add(v.second.data()));
     }
 
     pt::ptree stdparams_tree;
@@ -225,252 +176,579 @@ void Driver :: Load () {
             }
             // If the next found tag is param_type (String, Integer, Boolean,...),
             // store the earlier found param and param type.
-            else if (found && ptype.find(tag) != ptype.end()) {
-                param_name_type.insert(std::pair<std::string,std::string>(param_name, tag));
-                BOOST_LOG_SEV(lg, info) << "Param [" << param_name << "], Type [" << tag << "]";
+            else if (found && ParseParamType(tag) != ParamType::None) {
+                ParamId id = schema->params.Add(param_name);
+                schema->params.SetType(id, ParseParamType(tag));
+                LoadBounds(schema->params, id, p.second);
+                LoadEnumValues(schema->params, id, p.second);
+                BOOST_LOG_SEV(lg, debug) << "Param [" << param_name << "], Type [" << tag << "]";
                 found = false;
             }
         }
     }
+
+    // The params the driver handles itself get an ID even if the files do not list them.
+    schema->heartbeat_id = schema->params.Add("Heartbeat");
+    schema->status_id = schema->params.Add("Status");
+    schema->alert_id = schema->params.Add("Alert");
+    schema->alert_message_id = schema->params.Add("AlertMessage");
+
+    // Alert and AlertMessage are sent to RB in SendAlert function, hence skip these while sending status.
+    // Some params like DeviceTypeHash are set only on RB hence skip sending it.
+    schema->skip_status.assign(schema->params.Size(), 0);
+    schema->skip_status[schema->alert_id] = 1;
+    schema->skip_status[schema->alert_message_id] = 1;
+    schema->params.Build();
+    ParamId hash_id = schema->params.Find("DeviceTypeHash");
+    if (hash_id != NO_PARAM)
+        schema->skip_status[hash_id] = 1;
+    schema->BuildStatusFragments();
+
+    BOOST_LOG_SEV(lg, info) << "Registered [" << schema->params.Size() << "] params";
+
+    return schema;
 }
 
-void Driver :: SendCBOR (const std::string & msg) {
-    // Create a CBOR status message before sending it to STDOUT
-    cbor status_msg(msg);
-    cbor :: binary data = cbor :: encode(status_msg);
-    cbor item = cbor :: tagged (24, data);
-    item.write(std::cout);
-    fflush(stdout);
+Driver :: Driver(std::string dev_name, std::string arg_schema_file, std::string arg_std_params_file)
+          : frame_writer(nullptr) {
+
+    device_name = dev_name;
+    schema_file = arg_schema_file;
+    std_params_file = arg_std_params_file;
+
+    status_msg_format = "<Status><Device>" + dev_name + "</Device><DeviceType>_devicetype_</DeviceType><Param>_paramname_</Param><_paramtype_>_paramvalue_</_paramtype_></Status>\n";
+
+#ifdef _WIN32
+	setmode(fileno(stdout), O_BINARY);
+	setmode(fileno(stdin), O_BINARY);
+#endif
 }
 
-void Driver :: UpdateDeviceParam(const std::string& param, const std::string& value) {
-    param_name_val[param] = value;
+Driver :: ~Driver() {
+
 }
 
-std::string Driver :: GetParamValue(const std::string& param) {
-    return param_name_val[param];
+std :: string Driver :: GetStatusMsgFormat(void) {
+    return status_msg_format;
 }
 
-// SendStatus function would send the status of all the device params (Status/Control/RefControl) to RB server
-// if send_all_param is set to true. If it is set to false, it would only send the status
-// of the updated device status params.
-void Driver :: SendStatus ( std::map<std::string, std::string>& current_params,
-                                  bool send_all_param ) {
+std :: string Driver :: GetDeviceName(void) {
+    return device_name;
+}
+
+std :: string Driver :: GetDeviceType(void) {
+    return device_type;
+}
+
+const std::string& Driver :: FormatStatus(const std::string& name, const std::string& type, const std::string& value) {
+    status_template.Render(msg_buffer, {name, type, value});
+    return msg_buffer;
+}
+
+const std::string& Driver :: FormatAlert(const std::string& alert_type, const std::string& alert_message) {
+    alert_template.Render(msg_buffer, {alert_type, alert_message});
+    return msg_buffer;
+}
+
+const std::string& Driver :: FormatOperationalStatus(const std::string& status) {
+    operational_template.Render(msg_buffer, {status});
+    return msg_buffer;
+}
+
+const std::string& Driver :: FormatRangeAlert(void) {
+
+    std::ostringstream message;
+    message << "Parameters beyond range :";
+    const char* separator = " ";
+    out_of_range.ForEach([this, &message, &separator](ParamId id) {
+        const ParamBounds& range = schema->params.Bounds(id);
+        double multiplier = range.multiplier > 1 ? double(range.multiplier) : 1;
+        message << separator << schema->params.Name(id) << " " << param_values[id].Scaled(range)
+                << " (" << range.lower / multiplier << " to " << range.upper / multiplier << ")";
+        separator = ", ";
+    });
+    return FormatAlert(range_alert, message.str());
+}
+
+void Driver :: SendHeartBeat(std::chrono::steady_clock::duration interval) {
+
+    // RB expects the next heartbeat by the time given in seconds, so round up rather than
+    // announce it earlier than it is due.
+    auto next = std::chrono::system_clock::now().time_since_epoch() + interval;
+    auto next_seconds = std::chrono::duration_cast<std::chrono::seconds>(next);
+    if (next_seconds < next)
+        next_seconds += std::chrono::seconds(1);
+
+    SendCBOR(FormatStatus("Heartbeat", schema->params.TypeName(schema->heartbeat_id), std::to_string(next_seconds.count())));
+}
+
+void Driver :: GetParamDetails (const std::string& rb_msg,
+                                std::string& param_category,
+                                std::string& param_name,
+                                std::string& param_type,
+                                std::string& param_value) {
 
+    PerfScope perf(PerfHistogram::GetParamDetails);
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
-    // If only updated params are to be sent,
-    // keep only the updated entries and remove the rest.
-    // Also update the current params.
-    if ( send_all_param == false ) {
-        for ( const auto& entry : param_name_val ) {
-            std::map<std::string, std::string>::iterator it;
-            it = current_params.find(entry.first);
-            if ( it != current_params.end() ) {
-                // This device param value has not been updated.
-                // Hence remove it.
-                if ( current_params[entry.first] == entry.second ) {
-                    current_params.erase(it);
-                } else {
-                    // Update the in memory param_name_val
-                    param_name_val[entry.first] = current_params[entry.first];
-                }
-            }
-        }
+    /*  Below is the example of a control message from RB server
+        <Control>
+            <Device>Radio</Device>
+            <DeviceType>IsodeRadio</DeviceType>
+            <Param>Frequency</Param>
+            <Integer>22917</Integer>
+        </Control>
+    */
+
+    // Messages from RB are laid out as above, read those directly without building a
+    // property tree. Anything else goes through the XML parser.
+    RBMessage fields;
+    if (fields.Scan(rb_msg)) {
+        if (fields.root != "Control")
+            return;
+        param_name.assign(fields.param.data(), fields.param.size());
+        ClassifyParam(param_name, param_category, param_type);
+        if (param_category == "CONTROL" && fields.value_type == param_type)
+            param_value.assign(fields.value.data(), fields.value.size());
+        return;
     }
 
-    // Alert and AlertMessage are sent to RB in SendAlert function, hence skip these while sending status.
-    // Some params like DeviceTypeHash are set only on RB hence skip sending it.
-    std::string params_to_skip[]  = {"Alert", "AlertMessage", "DeviceTypeHash"};
-    std::set<std::string> skip(params_to_skip, params_to_skip + sizeof(params_to_skip)/sizeof(params_to_skip[0]));
+    BOOST_LOG_SEV(lg, debug) << "Control message not in the usual layout, using the XML parser";
 
-    for ( const auto& entry : current_params ) {
+    // Create empty property tree object
+    pt::ptree param_tree;
 
-        if (skip.find(entry.first) != skip.end())
-            continue;
+    try {
+        std :: stringstream ss;
+        ss << rb_msg;
+        read_xml(ss, param_tree);
+    } catch (pt::xml_parser_error &e) {
+        BOOST_LOG_SEV(lg, warning) << "Failed to parse control xml message from RB. " << e.what();
+    } catch (...) {
+        BOOST_LOG_SEV(lg, warning) << "Failed to read RB control message.";
+    }
 
-        std::string msg = status_msg_format;
-        msg = std::regex_replace(msg, std::regex("_paramname_"), entry.first);
-        msg = std::regex_replace(msg, std::regex("_paramtype_"), param_name_type[entry.first]);
-        msg = std::regex_replace(msg, std::regex("_paramvalue_"), entry.second);
+    // A malformed message must not throw out of the io_context, so look the element up
+    // without throwing.
+    auto control = param_tree.get_child_optional("Control");
+    if (!control)
+        return;
 
-        // Update the in memory device status params after all the device status params are sent.
-        // When only the updated params are to be sent back the status_param_val map gets updated
-        // in the above if block.
-        if ( send_all_param )
-            param_name_val[entry.first] = entry.second;
+    for (auto& v : *control) {
 
-        BOOST_LOG_SEV(lg, info) << "Sending device status params to RB : [" << msg << "]";
-        SendCBOR(msg);
+        std::string attr = v.first.data();
+
+        if (attr == "Param") {
+            param_name = v.second.data();
+            ClassifyParam(param_name, param_category, param_type);
+        } else if (v.first.data() == param_type && param_category == "CONTROL") {
+            param_value = v.second.data();
+        }
     }
 }
 
-IsodeRadioDriver :: IsodeRadioDriver (std::string dev_host, std::string dev_port, std::string dev_name,
-                                      std::string schema_file, std::string std_params_file)
-                    : Driver(dev_name, schema_file, std_params_file) {
-    device_host = dev_host;
-    device_port = dev_port;
+void Driver :: ClassifyParam (const std::string& param_name,
+                              std::string& param_category,
+                              std::string& param_type) const {
+
+    ParamId id = schema->params.Find(param_name);
+    if (id != NO_PARAM && schema->params.Type(id) != ParamType::None) {
+        param_category = "CONTROL";
+        param_type = schema->params.TypeName(id);
+    } else if (param_name == "SendParameters" || param_name == "Reset" || param_name == "PowerOff") {
+        param_category = "REFCONTROL";
+        param_type = "EMPTY";
+    }
+}
 
-    MONITOR_TIME = 5;
-    // HTTP version
-    version = 11;
+void Driver :: InitLogging (const std::string& log_name, logging::trivial::severity_level min_level) {
+    LogSink::Start("/tmp/" + log_name + "_%N.log", min_level, std::chrono::seconds(1));
 }
 
-// Send the HTTP Get request to the web device and fetch all the
-// device status and deivce control params.
-bool IsodeRadioDriver :: HTTPGet (const std::string& target, std::map<std::string, std::string>& stat_param_value) {
+void Driver :: Load () {
+    Load(DeviceSchema::Load(schema_file, std_params_file));
+}
+
+void Driver :: Load (std::shared_ptr<const DeviceSchema> arg_schema) {
+
+    schema = arg_schema;
+    device_type = schema->device_type;
+    device_family = schema->device_family;
+
+    param_values.assign(schema->params.Size(), ParamValue());
+    out_of_range.Resize(schema->params.Size());
+    param_reported.assign(schema->params.Size(), 0);
+    param_stored.assign(schema->params.Size(), std::chrono::steady_clock::time_point());
+    param_dirty.Resize(schema->params.Size());
+    param_deadband.assign(schema->params.Size(), 0);
+    param_sent.assign(schema->params.Size(), 0);
+    param_sent_valid.Resize(schema->params.Size());
+    param_known.assign(schema->params.Size(), 0);
+    for (ParamId id : schema->tracked_params)
+        param_known[id] = 1;
+
+    // The device name and type are fixed from here on, so substitute them once and
+    // parse the message formats into templates. Every status message is rendered from these.
+    boost::replace_all(status_msg_format, "_devicetype_", device_type);
+    status_template.Parse(status_msg_format, {"_paramname_", "_paramtype_", "_paramvalue_"});
+
+    status_head = "<Status><Device>" + device_name + "</Device><DeviceType>" + device_type + "</DeviceType>";
+    alert_template.Parse(status_head + "<Param>Alert</Param><_alerttype_></_alerttype_><AlertMessage>_alertmessage_</AlertMessage></Status>",
+                         {"_alerttype_", "_alertmessage_"});
+    operational_template.Parse(status_head + "<Param>Status</Param><Enumerated>_status_</Enumerated></Status>",
+                               {"_status_"});
+}
+
+void Driver :: SetDeadband (double percent) {
 
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
-    BOOST_LOG_SEV(lg, info) << "Sending HTTP Get request to device host : [" << \
-        device_host << "], device port : [" << device_port << "], Device Target [" << target << "]\n";
+    const ParamRegistry& params = schema->params;
+    for (ParamId id = 0; id < params.Size(); id++) {
+        const ParamBounds& range = params.Bounds(id);
+        param_deadband[id] = 0;
+        if (params.Type(id) != ParamType::Integer || !range.bounded || percent <= 0)
+            continue;
 
-    try {
-        // These objects perform our I/O
-        tcp::resolver resolver(ioc);
-        beast::tcp_stream stream(ioc);
+        // Example : VSWR is bounded by 10 and 100, so with a deadband of 5% a change of
+        // less than 4 is not reported.
+        param_deadband[id] = static_cast<long long>((range.upper - range.lower) * percent / 100);
+        if (param_deadband[id] > 0) {
+            BOOST_LOG_SEV(lg, debug) << "Param [" << params.Name(id) << "], Deadband [" << param_deadband[id] << "]";
+        }
+    }
+}
+
+void Driver :: SendCBOR (const std::string & msg) {
+    PerfScope perf(PerfHistogram::SendCBOR);
+    if (frame_writer) {
+        frame_writer->Write(msg);
+        return;
+    }
 
-        // Look up the domain name
-        auto const results = resolver.resolve(device_host, device_port);
+    // Wrap the status message in a CBOR frame and write it to STDOUT in one go
+    frame_buffer.clear();
+    frame_buffer.write_embedded_string(msg.data(), msg.size());
+    fwrite(frame_buffer.data(), 1, frame_buffer.size(), stdout);
+    fflush(stdout);
+}
+
+void Driver :: SetFrameWriter (FrameWriter* writer) {
+    frame_writer = writer;
+}
+
+void Driver :: UpdateDeviceParam(const std::string& param, const std::string& value) {
+    ParamId id = schema->params.Find(param);
+    if (id != NO_PARAM)
+        StoreValue(id, value);
+}
 
-        // Make the connection on the IP address we get from a lookup
-        stream.connect(results);
+std::string Driver :: GetParamValue(const std::string& param) {
+    ParamId id = schema->params.Find(param);
+    return id != NO_PARAM ? param_values[id].Text() : std::string();
+}
 
-        // Set up an HTTP GET request message
-        http::request<http::string_body> req{http::verb::get, target, version};
-        req.set(http::field::host, device_host);
-        req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+const std::string& Driver :: GetParamValue(ParamId id) const {
+    return param_values[id].Text();
+}
 
-        // Send the HTTP request to the remote host
-        http::write(stream, req);
+bool Driver :: StoreValue(ParamId id, boost::string_view value) {
 
-        // This buffer is used for reading and must be persisted
-        beast::flat_buffer buffer;
+    if (!param_values[id].Assign(schema->params, id, value))
+        return false;
+
+    const ParamBounds& range = schema->params.Bounds(id);
+    if (!range.bounded)
+        return true;
+    if (param_values[id].OutOfRange(range)) {
+        if (!out_of_range.Test(id)) {
+            using namespace logging::trivial;
+            src::severity_logger<severity_level> lg;
+            BOOST_LOG_SEV(lg, warning) << "Param [" << schema->params.Name(id) << "] value [" << value \
+                << "] is beyond its range [" << range.lower << ", " << range.upper << "]";
+        }
+        out_of_range.Set(id);
+    } else {
+        out_of_range.Reset(id);
+    }
+    return true;
+}
 
-        // Declare a container to hold the response
-        http::response<http::string_body> res;
+bool Driver :: StoreDeviceResponse(boost::string_view response, DeviceSnapshot& snapshot) {
 
-        // Receive the HTTP response
-        http::read(stream, buffer, res);
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
 
-        // Write the message to standard out
-        // std::cout << res << std::endl;
+    // Example : the response {"PowerSupplyConsumption":"31","Temperature":"40"} sets
+    // the values in the slots of the PowerSupplyConsumption and Temperature IDs.
+    JSONObjectReader reader(response);
+    JSONObjectReader::Member member;
+    snapshot.changed = 0;
+    snapshot.unchecked = 0;
 
-        // Gracefully close the socket
-        beast::error_code ec;
-        stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    while (reader.Next(member)) {
 
-        // not_connected happens sometimes
-        // so don't bother reporting it.
-        //
-        if(ec && ec != beast::errc::not_connected)
-            throw beast::system_error{ec};
+        // A key with escapes can't be the name of a param, so it is skipped with the
+        // other unknown keys.
+        ParamId id = member.key_escaped ? NO_PARAM : schema->params.Find(member.key);
+        if (id == NO_PARAM || member.kind == JSONObjectReader::NESTED)
+            continue;
 
-        std :: stringstream response;
-        response << res.body();
+        // The value held came from a later request or event, this one is stale.
+        if (param_stored[id] > snapshot.requested)
+            continue;
 
-        ptree pt;
-        read_json(response, pt);
+        boost::string_view value = member.value;
+        if (member.value_escaped) {
+            if (!JSONObjectReader::Unescape(member.value, unescaped)) {
+                BOOST_LOG_SEV(lg, warning) << "Invalid escape in the value of param : [" << schema->params.Name(id) << "]";
+                continue;
+            }
+            value = unescaped;
+        }
 
-        /*
-        Status Message Format
-        <Status>\
-        <Device>_devicename_</Device>\
-        <DeviceType>_devicetype_</DeviceType>\
-        <Param>_paramname_</Param>\
-        <_paramtype_>_paramvalue_</_paramtype_>\
-        </Status>
-        */
+        param_reported[id] = 1;
+        param_stored[id] = snapshot.requested;
 
-        // Example : ptree with one entry would have something like { "PowerSupplyConsumption" : "31" }
-        // status_param_type is a map like { "PowerSupplyConsumption" : "Integer" }
-        for (ptree::const_iterator it = pt.begin(); it != pt.end(); ++it) {
+        // Alert, AlertMessage and DeviceTypeHash are not sent as status, see DeviceSchema::Load.
+        if (schema->skip_status[id]) {
+            if (StoreValue(id, value)) {
+                snapshot.changed++;
+                snapshot.unchecked++;
+            }
+            continue;
+        }
 
-            std::string param = it->first;
-            std::string value = it->second.get_value<std::string>();
-            stat_param_value.insert(std::pair<std::string,std::string>(param, value) );
+        // A param the driver does not track is sent on every update.
+        if (StoreValue(id, value)) {
+            snapshot.changed++;
+            if (!schema->params.Bounds(id).bounded)
+                snapshot.unchecked++;
+            if (!WithinDeadband(id))
+                param_dirty.Set(id);
+        } else if (!param_known[id]) {
+            param_dirty.Set(id);
         }
-        // If we get here then the connection is closed gracefully
-    } catch ( std::exception const& e ) {
-        BOOST_LOG_SEV(lg, info) << "Error : " << e.what() << std::endl;
-        return false;
     }
-    return true;
+
+    return !reader.Failed();
 }
 
-// Send the HTTP Post request to the web device and set the
-// device control params.
-bool IsodeRadioDriver :: HTTPPost (const std::string& target,
-                                  const std::string& param,
-                                  const std::string& value) {
+bool Driver :: WithinDeadband (ParamId id) const {
+
+    const ParamValue& param = param_values[id];
+    if (param_deadband[id] == 0 || !param_sent_valid.Test(id) || !param.Valid())
+        return false;
+
+    // Always report a value that has left its bounds, however small the step.
+    if (out_of_range.Test(id))
+        return false;
+
+    long long value = param.Integer();
+
+    long long moved = value > param_sent[id] ? value - param_sent[id] : param_sent[id] - value;
+    return moved < param_deadband[id];
+}
+
+void Driver :: SendParamStatus (ParamId id) {
+
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
-    BOOST_LOG_SEV(lg, info) << "Sending HTTP Post request to device host : [" << \
-        device_host << "], device port : [" << device_port << "], Device Target [" << target << "]\n";
+    if (param_deadband[id] != 0 && param_values[id].Valid()) {
+        param_sent[id] = param_values[id].Integer();
+        param_sent_valid.Set(id);
+    }
 
-    try {
+    // The same text as FormatStatus, from fragments made once per device and per param.
+    msg_buffer.assign(status_head);
+    msg_buffer.append(schema->status_open[id]);
+    msg_buffer.append(param_values[id].Text());
+    msg_buffer.append(schema->status_close[id]);
+    const std::string& msg = msg_buffer;
 
-        // These objects perform our I/O
-        tcp::resolver resolver(ioc);
-        beast::tcp_stream stream(ioc);
+    BOOST_LOG_SEV(lg, debug) << "Sending device status params to RB : [" << msg << "]";
+    SendCBOR(msg);
+}
 
-        // Look up the domain name
-        auto const results = resolver.resolve(device_host, device_port);
+// Store a value the device has accepted and confirm it to RB straight away.
+void Driver :: ReportParamValue (ParamId id, const std::string& value) {
 
-        // Make the connection on the IP address we get from a lookup
-        stream.connect(results);
+    StoreValue(id, value);
+    param_reported[id] = 1;
+    param_stored[id] = std::chrono::steady_clock::now();
+    param_dirty.Reset(id);
+    SendParamStatus(id);
+}
 
-        // Set up an HTTP POST request message
-        ptree root;
-        root.put (param, value);
-        std::ostringstream buf;
-        write_json (buf, root, false);
-        std::string json = buf.str();
+// SendStatus function would send the status of all the device params (Status/Control/RefControl) to RB server
+// if send_all_param is set to true. If it is set to false, it would only send the status
+// of the updated device status params.
+void Driver :: SendStatus ( bool send_all_param ) {
 
-        BOOST_LOG_SEV(lg, info) << "Composed JSON message : " << json;
+    PerfScope perf(PerfHistogram::SendStatus);
+    if ( send_all_param == false ) {
+        // Only the params marked as changed are visited, in ID order, which is the order of the schema.
+        param_dirty.ForEach([this](ParamId id) { SendParamStatus(id); });
+    } else {
+        for ( ParamId id = 0; id < param_values.size(); id++ ) {
 
-        http::request<http::string_body> req{http::verb::post, target, version};
-        req.set(http::field::host, device_host);
-        req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
-        req.set(http::field::content_type, "application/json");
-        req.set(http::field::content_length, boost::lexical_cast<std::string>(json.size()));
-        req.body() = json;
-        req.prepare_payload();
+            // Alert, AlertMessage and DeviceTypeHash are not sent as status, see DeviceSchema::Load.
+            if (!param_reported[id] || schema->skip_status[id])
+                continue;
 
-        // Send the HTTP request to the remote host
-        http::write(stream, req);
+            // From here on only changes of the param are sent.
+            param_known[id] = 1;
+            SendParamStatus(id);
+        }
+    }
+    param_dirty.Clear();
+}
 
-        // This buffer is used for reading and must be persisted
-        beast::flat_buffer buffer;
+IsodeRadioDriver :: IsodeRadioDriver (net::io_context& arg_ioc, HTTPConnectionPool& arg_http_pool,
+                                      FrameWriter& arg_frame_writer, std::string dev_host, std::string dev_port, std::string dev_name,
+                                      std::string schema_file, std::string std_params_file)
+                    : Driver(dev_name, schema_file, std_params_file),
+                      ioc(arg_ioc),
+                      http_pool(arg_http_pool),
+                      heartbeat_interval(std::chrono::seconds(5)),
+                      monitor_timer(arg_ioc),
+                      heartbeat_timer(arg_ioc),
+                      fetch_in_progress(false),
+                      use_events(false),
+                      full_group(0),
+                      sweep_interval(std::chrono::seconds(60)),
+                      control_in_flight(false),
+                      control_count(0),
+                      control_post_count(0) {
+    device_host = dev_host;
+    device_port = dev_port;
+    SetFrameWriter(&arg_frame_writer);
 
-        // Declare a container to hold the response
-        http::response<http::dynamic_body> res;
+    SetPollIntervals(PollIntervals());
+    // HTTP version
+    version = 11;
+}
 
-        // Receive the HTTP response
-        http::read(stream, buffer, res);
+// Send the HTTP Get request to the web device and fetch all the
+// device status and deivce control params.
+void IsodeRadioDriver :: HTTPGet (const std::string& target, SnapshotHandler handler) {
 
-        // Write the message to standard out
-        // std::cout << res << std::endl;
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
 
-        // Gracefully close the socket
-        beast::error_code ec;
-        stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    BOOST_LOG_SEV(lg, debug) << "Sending HTTP Get request to device host : [" << \
+        device_host << "], device port : [" << device_port << "], Device Target [" << target << "]\n";
 
-        // not_connected happens sometimes
-        // so don't bother reporting it.
-        //
-        if( ec && ec != beast::errc::not_connected )
-            throw beast::system_error{ec};
+    // Set up an HTTP GET request message
+    auto exchange = std::make_shared<HTTPExchange>();
+    exchange->req = http::request<http::string_body>{http::verb::get, target, version};
+    exchange->req.set(http::field::host, device_host);
+    exchange->req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    auto etag = etags.find(target);
+    if (etag != etags.end())
+        exchange->req.set(http::field::if_none_match, etag->second);
+
+    // Send the HTTP request on a kept-alive connection and receive the response
+    PerfStart started = PerfStats::Now();
+    std::chrono::steady_clock::time_point requested = std::chrono::steady_clock::now();
+    http_pool.AsyncRequest(exchange, http_timeout, [this, exchange, target, handler, started, requested](beast::error_code ec) {
+
+        using namespace logging::trivial;
+        src::severity_logger<severity_level> lg;
+
+        DeviceSnapshot snapshot;
+        snapshot.requested = requested;
+        snapshot.fetched = std::chrono::steady_clock::now();
+
+        // Once the device has not responded, its status is no longer what it reported, so
+        // whatever it has next is wanted in full.
+        if (ec) {
+            BOOST_LOG_SEV(lg, warning) << "Error : " << ec.message();
+            PerfStats::Add(PerfCounter::HTTPErrors);
+            etags.clear();
+            handler(snapshot);
+            return;
+        }
 
-        // If we get here then the connection is closed gracefully
-    } catch ( std::exception const& e ) {
-        BOOST_LOG_SEV(lg, info) << "Error: " << e.what();
-        return false;
-    }
-    return true;
+        // Nothing has changed since the values held were fetched, there is nothing to decode.
+        if (exchange->res.result() == http::status::not_modified) {
+            snapshot.valid = true;
+            snapshot.not_modified = true;
+            PerfStats::RecordSince(PerfHistogram::HTTPGet, started);
+            PerfStats::Add(PerfCounter::NotModified);
+            handler(snapshot);
+            return;
+        }
+
+        // The body is decoded where the response was read into, straight into the
+        // param values.
+        snapshot.valid = Driver :: StoreDeviceResponse(exchange->res.body(), snapshot);
+        PerfStats::RecordSince(PerfHistogram::HTTPGet, started);
+        if (!snapshot.valid)
+            BOOST_LOG_SEV(lg, warning) << "Error : device response is not a JSON object";
+
+        auto etag = exchange->res.find(http::field::etag);
+        if (snapshot.valid && etag != exchange->res.end())
+            etags[target].assign(etag->value().data(), etag->value().size());
+        else
+            etags.erase(target);
+        handler(snapshot);
+    });
+}
+
+// Send the HTTP Post request to the web device and set the
+// device control params.
+void IsodeRadioDriver :: HTTPPost (const std::string& target,
+                                  const ptree& params,
+                                  PostHandler handler) {
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    BOOST_LOG_SEV(lg, debug) << "Sending HTTP Post request to device host : [" << \
+        device_host << "], device port : [" << device_port << "], Device Target [" << target << "]\n";
+
+    // Set up an HTTP POST request message
+    std::ostringstream buf;
+    write_json (buf, params, false);
+    std::string json = buf.str();
+
+    BOOST_LOG_SEV(lg, debug) << "Composed JSON message : " << json;
+
+    auto exchange = std::make_shared<HTTPExchange>();
+    exchange->req = http::request<http::string_body>{http::verb::post, target, version};
+    exchange->req.set(http::field::host, device_host);
+    exchange->req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    exchange->req.set(http::field::content_type, "application/json");
+    exchange->req.body() = json;
+    exchange->req.prepare_payload();
+
+    // Send the HTTP request on a kept-alive connection and receive the response
+    PerfStart started = PerfStats::Now();
+    http_pool.AsyncRequest(exchange, http_timeout, [exchange, handler, started](beast::error_code ec) {
+
+        using namespace logging::trivial;
+        src::severity_logger<severity_level> lg;
+
+        if (ec) {
+            BOOST_LOG_SEV(lg, warning) << "Error: " << ec.message();
+            PerfStats::Add(PerfCounter::HTTPErrors);
+            handler(false);
+            return;
+        }
+        PerfStats::RecordSince(PerfHistogram::HTTPPost, started);
+
+        // The device answers, but has not taken the values.
+        if (exchange->res.result_int() / 100 != 2) {
+            BOOST_LOG_SEV(lg, warning) << "Error: device answered [" << exchange->res.result_int() << "]";
+            PerfStats::Add(PerfCounter::HTTPErrors);
+            handler(false);
+            return;
+        }
+        handler(true);
+    });
 }
 
 // Send the HTTP request ( Get / Post ) to the web device based
@@ -480,7 +758,7 @@ void IsodeRadioDriver :: SendHTTPRequest (const std::string& rb_msg) {
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
-    BOOST_LOG_SEV(lg, info) << "Received message from RB : [" << rb_msg << "]";
+    BOOST_LOG_SEV(lg, debug) << "Received message from RB : [" << rb_msg << "]";
 
     std :: string param_category("");
     std :: string param_name("");
@@ -488,78 +766,168 @@ void IsodeRadioDriver :: SendHTTPRequest (const std::string& rb_msg) {
     std :: string param_value("");
 
     Driver :: GetParamDetails (rb_msg, param_category, param_name, param_type, param_value);
-    BOOST_LOG_SEV(lg, info) << "Param Category : [" << param_category << "]" << " Name : [" << param_name \
+    BOOST_LOG_SEV(lg, debug) << "Param Category : [" << param_category << "]" << " Name : [" << param_name \
         << "] Value : [" << param_value << "]";
 
     // Send HTTP Post Request
     if ( param_category == "CONTROL" ) {
-        std :: string target("/device/" + Driver :: GetDeviceName() + "/control");
-        if (HTTPPost(target, param_name, param_value)) {
-            std::string msg = Driver :: GetStatusMsgFormat();
-            msg = std::regex_replace(msg, std::regex("_paramname_"), param_name);
-            msg = std::regex_replace(msg, std::regex("_paramtype_"), param_type);
-            msg = std::regex_replace(msg, std::regex("_paramvalue_"), param_value);
-            msg = std::regex_replace(msg, std::regex("Control"), "Status");
-            msg += "\n";
-            BOOST_LOG_SEV(lg, info) << "Sending status messages : [" << msg << "]";
-            // Create a CBOR referenced status message before sending it to STDOUT
-            SendCBOR(msg);
-        }
+        QueueControl(Driver :: GetSchema().params.Find(param_name), param_value);
     } else if ( param_category == "REFCONTROL") {
         if (param_name == "SendParameters") {
             bool all_params_flag = true;
             ReportStatusToRB(all_params_flag);
         } else if (param_name == "Reset") {
             std :: string target("/device/" + Driver :: GetDeviceName() + "/reset");
-            std :: map<std::string, std::string> current_params;
-            if (HTTPGet(target, current_params)) {
+            HTTPGet(target, [this](const DeviceSnapshot& snapshot) {
+                if (!snapshot.valid)
+                    return;
+
+                using namespace logging::trivial;
+                src::severity_logger<severity_level> lg;
+
                 BOOST_LOG_SEV(lg, info) << "Device " << GetDeviceName() << " Reset Succcessfully !!";
                 // Send the values of the parameters to RB
                 bool all_params_flag = true;
-                Driver :: SendStatus(current_params, all_params_flag);
-            }
+                Driver :: SendStatus(all_params_flag);
+            });
         } else if (param_name == "PowerOff") {
             std :: string target("/device/" + Driver :: GetDeviceName() + "/poweroff");
-            std :: map<std::string, std::string> current_params;
-            if (HTTPGet(target, current_params)) {
+            HTTPGet(target, [this](const DeviceSnapshot& snapshot) {
+                if (!snapshot.valid)
+                    return;
+
+                using namespace logging::trivial;
+                src::severity_logger<severity_level> lg;
+
                 BOOST_LOG_SEV(lg, info) << "Device " << GetDeviceName() << " Powered Off Succcessfully !!";
                 // Send the values of the parameters to RB
                 bool all_params_flag = true;
-                Driver :: SendStatus(current_params, all_params_flag);
-            }
+                Driver :: SendStatus(all_params_flag);
+            });
         }
     }
 }
 
-void IsodeRadioDriver :: ReportStatusToRB (bool all_params_flag) {
+void IsodeRadioDriver :: QueueControl (ParamId id, const std::string& value) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    // Only the last value of a param counts, e.g. while an operator sweeps the Frequency.
+    control_count++;
+    if (control_pending.Test(id)) {
+        BOOST_LOG_SEV(lg, debug) << "Replacing queued value [" << control_values[id] << "] of param [" \
+            << GetSchema().params.Name(id) << "]";
+    }
+    control_values[id] = value;
+    control_pending.Set(id);
+    control_retried.Reset(id);
+
+    // Changes arriving while a write is in flight are written together once it completes.
+    if (!control_in_flight)
+        WriteControls();
+}
+
+void IsodeRadioDriver :: WriteControls (void) {
 
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
+    const ParamRegistry& params = GetSchema().params;
+
+    // Take every queued value, so that changes arriving from here on wait for the next write.
+    auto written = std::make_shared<std::vector<std::pair<ParamId, std::string>>>();
+    ptree body;
+    control_pending.ForEach([&](ParamId id) {
+        // push_back rather than put, as put would take a '.' in a name for a path.
+        body.push_back(ptree::value_type(params.Name(id), ptree(control_values[id])));
+        written->push_back(std::make_pair(id, std::move(control_values[id])));
+    });
+    control_pending.Clear();
+
+    control_in_flight = true;
+    control_post_count++;
+    BOOST_LOG_SEV(lg, debug) << "Writing [" << written->size() << "] control params, control messages : [" \
+        << control_count << "], POSTs : [" << control_post_count << "]";
+
+    std :: string target("/device/" + Driver :: GetDeviceName() + "/control");
+    HTTPPost(target, body, [this, written](bool ok) {
+
+        using namespace logging::trivial;
+        src::severity_logger<severity_level> lg;
+
+        control_in_flight = false;
+
+        // Confirm the values to RB, all in one write.
+        if (ok) {
+            for (const auto& entry : *written) {
+                control_retried.Reset(entry.first);
+                Driver :: ReportParamValue(entry.first, entry.second);
+            }
+        } else {
+            // Try each value once more, unless RB has sent a newer one meanwhile.
+            std::string dropped;
+            for (auto& entry : *written) {
+                if (control_pending.Test(entry.first))
+                    continue;
+                if (control_retried.Test(entry.first)) {
+                    control_retried.Reset(entry.first);
+                    dropped += (dropped.empty() ? "" : ", ") + GetSchema().params.Name(entry.first) + "=" + entry.second;
+                    continue;
+                }
+                control_values[entry.first] = std::move(entry.second);
+                control_pending.Set(entry.first);
+                control_retried.Set(entry.first);
+            }
+            BOOST_LOG_SEV(lg, warning) << "Device did not accept [" << written->size() << "] control params";
+            if (!dropped.empty())
+                BOOST_LOG_SEV(lg, warning) << "Dropping control values the device did not accept twice : [" << dropped << "]";
+        }
+
+        if (control_pending.Any()) {
+            WriteControls();
+        } else if (on_drained) {
+            std::function<void()> done = std::move(on_drained);
+            on_drained = nullptr;
+            done();
+        }
+    });
+}
+
+void IsodeRadioDriver :: ReportStatusToRB (bool all_params_flag) {
+
     // Fetch the current params values
-    std :: string device_name = Driver :: GetDeviceName();
-    std :: string target("/device/" + device_name);
-    std :: map<std::string, std::string> current_params;
+    HTTPGet("/device/" + Driver :: GetDeviceName(), [this, all_params_flag](const DeviceSnapshot& snapshot) {
+        ReportStatusToRB(all_params_flag, snapshot);
+    });
+}
 
-    std::string status_msg = "<Status><Device>_devicename_</Device><DeviceType>_devicetype_</DeviceType><Param>Status</Param><Enumerated>Operational</Enumerated></Status>";
-    status_msg = std::regex_replace(status_msg, std::regex("_devicename_"), device_name);
-    status_msg = std::regex_replace(status_msg, std::regex("_devicetype_"), GetDeviceType());
+void IsodeRadioDriver :: ReportStatusToRB (bool all_params_flag, const DeviceSnapshot& snapshot) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    std :: string device_name = Driver :: GetDeviceName();
+    std::string status("Operational");
 
-    if (HTTPGet(target, current_params)) {
-        if (Driver::GetParamValue("Status") == "Not Operational") {
-            status_msg = std::regex_replace(status_msg, std::regex("Operational"), "Not Operational");
+    if (snapshot.valid) {
+        if (Driver :: GetParamValue(Driver :: GetSchema().status_id) == "Not Operational") {
+            status = "Not Operational";
         }
-        // Send the values of the parameters to RB
-        Driver :: SendStatus(current_params, all_params_flag);
-        BOOST_LOG_SEV(lg, info) << "Device [" << device_name << "] operational.";
+        // Send the values of the parameters to RB. After a 304 there is nothing to send,
+        // unless another group of the same tick changed.
+        if (all_params_flag || !snapshot.not_modified || ParamsChanged())
+            Driver :: SendStatus(all_params_flag);
+        BOOST_LOG_SEV(lg, debug) << "Device [" << device_name << "] operational.";
     } else {
         // Device not responding.
-        status_msg = std::regex_replace(status_msg, std::regex("Operational"), "Not Operational");
-        BOOST_LOG_SEV(lg, info) << "Device [" << device_name << "] not responding.";
+        status = "Not Operational";
+        BOOST_LOG_SEV(lg, warning) << "Device [" << device_name << "] not responding.";
         Driver :: UpdateDeviceParam("Status", "Not Operational");
     }
 
-    BOOST_LOG_SEV(lg, info) << "Sending device status to RB : [" << status_msg << "]";
+    const std::string& status_msg = Driver :: FormatOperationalStatus(status);
+    BOOST_LOG_SEV(lg, debug) << "Sending device status to RB : [" << status_msg << "]";
     SendCBOR(status_msg);
 }
 
@@ -567,137 +935,528 @@ void IsodeRadioDriver :: SendMsgToDevice (const std::string& rb_msg) {
     SendHTTPRequest(rb_msg);
 }
 
-void IsodeRadioDriver :: SendAlert () {
+void IsodeRadioDriver :: SendAlert (const DeviceSnapshot& snapshot) {
 
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
-    std :: string device_name = Driver :: GetDeviceName();
-    std :: string target("/device/" + device_name);
-    std :: map<std::string, std::string> current_params;
-
-    if (!HTTPGet(target, current_params))
+    if (!snapshot.valid)
         return;
 
-    std::string msg = "<Status><Device>_devicename_</Device><DeviceType>_devicetype_</DeviceType><Param>Alert</Param><_alerttype_></_alerttype_><AlertMessage>_alertmessage_</AlertMessage></Status>";
-    msg = std::regex_replace(msg, std::regex("_devicename_"), device_name);
-    msg = std::regex_replace(msg, std::regex("_devicetype_"), GetDeviceType());
-    msg = std::regex_replace(msg, std::regex("_alerttype_"), current_params["Alert"]);
-    msg = std::regex_replace(msg, std::regex("_alertmessage_"), current_params["AlertMessage"]);
+    // A param beyond its range raises a warning from this very response, as the device
+    // itself would on its next /ref, unless the device already reports something else.
+    const std::string& msg = OutOfRange() && !DeviceAlerting()
+        ? Driver :: FormatRangeAlert()
+        : Driver :: FormatAlert(GetParamValue(GetSchema().alert_id), GetParamValue(GetSchema().alert_message_id));
 
-    BOOST_LOG_SEV(lg, info) << "Sending alert message to RB : [" << msg << "]";
+    BOOST_LOG_SEV(lg, debug) << "Sending alert message to RB : [" << msg << "]";
     SendCBOR(msg);
 }
 
-void IsodeRadioDriver :: Start (void) {
+void IsodeRadioDriver :: ScheduleMonitor (void) {
+
+    // Keep a fixed cadence from the previous expiry, however long the tick took.
+    monitor_timer.expires_at(monitor_timer.expiry() + poll_intervals.tick);
+    monitor_timer.async_wait([this](beast::error_code ec) {
+        if (ec)
+            return;
+        MonitorTick();
+        ScheduleMonitor();
+    });
+}
+
+void IsodeRadioDriver :: ScheduleHeartBeat (void) {
+
+    // The heartbeat has a timer of its own so that neither a slow device nor a late monitor
+    // tick holds it up. Keep a fixed cadence, unless the timer has fallen more than a whole
+    // interval behind, in which case a burst of heartbeats would be no use to RB.
+    auto next = heartbeat_timer.expiry() + heartbeat_interval;
+    auto now = std::chrono::steady_clock::now();
+    if (next < now)
+        next = now + heartbeat_interval;
+
+    heartbeat_timer.expires_at(next);
+    heartbeat_timer.async_wait([this](beast::error_code ec) {
+        if (ec)
+            return;
+        PerfStats::RecordSince(PerfHistogram::HeartBeatDrift, heartbeat_timer.expiry());
+        // Written straight away, even while a monitor tick holds its frames back.
+        SendHeartBeat(heartbeat_interval);
+        GetFrameWriter()->Flush();
+        ScheduleHeartBeat();
+    });
+}
+
+void IsodeRadioDriver :: MonitorTick (void) {
 
-    InitLogging();
     using namespace logging::trivial;
     src::severity_logger<severity_level> lg;
 
-    try {
-        Load();
-    } catch (std::exception &e) {
-        std::cout << "Error: " << e.what() << "\n";
+    // The poll interval has expired so send a status update.
+    // Get the param groups that are due from the device and send the changes to RB.
+    BOOST_LOG_SEV(lg, debug) << "Monitoring device status. Connections opened : [" << http_pool.GetConnectCount() \
+        << "], reused : [" << http_pool.GetReuseCount() << "], DNS lookups : [" << http_pool.GetResolveCount() << "]";
+
+    // Write the status updates of this tick together. They are only held back for the
+    // writer's max delay, however slow the device is.
+    GetFrameWriter()->BeginBatch();
+    PerfStats::Add(PerfCounter::MonitorTicks);
+
+    // A slow device may still be answering the previous tick's query, don't queue another one.
+    if (fetch_in_progress) {
+        BOOST_LOG_SEV(lg, warning) << "Previous device query still outstanding, skipping this one";
+        PerfStats::Add(PerfCounter::SkippedTicks);
+        GetFrameWriter()->EndBatch();
+        return;
+    }
+
+    // Scheduling from when the tick was due keeps the groups in step with the ticks.
+    // While the device pushes its changes, only poll all of its params now and then in
+    // case an event went missing.
+    tick_time = monitor_timer.expiry();
+    if (events && events->Up()) {
+        due_groups.clear();
+        if (tick_time >= sweep_due) {
+            due_groups.push_back(full_group);
+            sweep_due = tick_time + sweep_interval;
+        }
+    } else {
+        poller.Due(tick_time, due_groups);
+        // All the params include the status and referenced status params.
+        if (std::find(due_groups.begin(), due_groups.end(), full_group) != due_groups.end())
+            due_groups.assign(1, full_group);
     }
+    if (due_groups.empty()) {
+        BOOST_LOG_SEV(lg, debug) << "No device params due for polling";
+        GetFrameWriter()->EndBatch();
+        return;
+    }
+
+    // The alert and the status below both report on the groups fetched now.
+    fetch_in_progress = true;
+    PollGroup(0);
+}
+
+void IsodeRadioDriver :: PollGroup (std::size_t index) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    std::size_t group = due_groups[index];
+    BOOST_LOG_SEV(lg, debug) << "Querying device params [" << poller.Target(group) << "], polls : [" \
+        << poller.GetPollCount(group) << "], interval : [" \
+        << std::chrono::duration_cast<std::chrono::milliseconds>(poller.Interval(group)).count() << "] ms";
+
+    HTTPGet(poller.Target(group), [this, index, group](const DeviceSnapshot& snapshot) {
+
+        // Poll everything again on the next tick to notice when the device is back.
+        if (!snapshot.valid) {
+            poller.SpeedUp(tick_time);
+            FinishPoll(snapshot);
+            return;
+        }
+
+        // A group backs off while its values stay the same and the device is not alerting.
+        if (group == full_group)
+            PolledAll(tick_time, snapshot.changed != 0 || Alerting());
+        else
+            poller.Polled(group, tick_time, snapshot.changed != 0 || Alerting());
+
+        // The device raises its alerts on changes of the status params, so follow a change
+        // with the referenced status params, which carry the alert, in the same tick. The
+        // driver checks bounded params itself, so a change of those only needs the device's
+        // word while it is alerting, to see the alert cleared.
+        if (group == status_group && (snapshot.unchecked != 0 || (snapshot.changed != 0 && DeviceAlerting())) &&
+            std::find(due_groups.begin(), due_groups.end(), ref_group) == due_groups.end())
+            due_groups.push_back(ref_group);
+
+        if (index + 1 < due_groups.size())
+            PollGroup(index + 1);
+        else
+            FinishPoll(snapshot);
+    });
+}
+
+void IsodeRadioDriver :: PolledAll (std::chrono::steady_clock::time_point when, bool changed) {
+    poller.Polled(full_group, when, changed);
+    poller.Polled(status_group, when, changed);
+    poller.Polled(ref_group, when, changed);
+}
+
+void IsodeRadioDriver :: FinishPoll (const DeviceSnapshot& snapshot) {
 
-    bool all_params_flag = true;
-    // Report initial status of the device params to the RB server.
-    ReportStatusToRB(all_params_flag);
-
-    // Initial status of the device has been reported, now start the monitoring timer.
-    auto timenow = std::chrono::system_clock::now();
-
-    // Send the first heart beat message
-    SendHeartBeat(MONITOR_TIME);
-
-    std::condition_variable cv;
-    std::mutex mutex_;
-
-    // thread to read msg from stdin and sending message to the device.
-    std::thread io ([&] {
-        while (true) {
-            BOOST_LOG_SEV(lg, info) << "Waiting to receive data...";
-            cbor item;
-            item.read (std::cin);
-            std::ostringstream obj;
-            item.write(obj);
-            std::string rb_msg = obj.str();
-            std::size_t first = rb_msg.find("<Control");
-            rb_msg = rb_msg.erase(0, first);
-            std::lock_guard<std::mutex> lock(mutex_);
-            SendMsgToDevice(rb_msg);
+    fetch_in_progress = false;
+
+    unsigned long long frames = GetFrameWriter()->GetFrameCount();
+    ReportSnapshot(snapshot, tick_time);
+    PerfStats::Record(PerfHistogram::FramesPerTick, GetFrameWriter()->GetFrameCount() - frames);
+
+    GetFrameWriter()->EndBatch();
+}
+
+void IsodeRadioDriver :: ReportSnapshot (const DeviceSnapshot& snapshot, std::chrono::steady_clock::time_point when) {
+
+    // A new alert brings every group back to its base interval, so a problem is followed
+    // closely from the start.
+    if (snapshot.valid) {
+        const std::string& alert = OutOfRange() && !DeviceAlerting() ? range_alert : GetParamValue(GetSchema().alert_id);
+        if (alert != last_alert) {
+            if (Alerting())
+                poller.SpeedUp(when);
+            last_alert = alert;
         }
+    }
+
+    // Send alert message to RB
+    SendAlert(snapshot);
+
+    // Send status of the updated params to RB
+    bool all_params_flag = false;
+    ReportStatusToRB(all_params_flag, snapshot);
+}
+
+void IsodeRadioDriver :: OnDeviceEvent (const std::string& type, const std::string& data) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    if (type != "params")
+        return;
+
+    BOOST_LOG_SEV(lg, debug) << "Event from device [" << GetDeviceName() << "] : [" << data << "]";
+    PerfStats::Add(PerfCounter::DeviceEvents);
+
+    // The event holds the params that changed, in the same form as a poll. Every frame
+    // it gives rise to goes out in one write once this handler returns. A poll that was
+    // sent before the event and answers after it leaves these params alone.
+    DeviceSnapshot snapshot;
+    snapshot.fetched = std::chrono::steady_clock::now();
+    snapshot.requested = snapshot.fetched;
+    snapshot.valid = Driver :: StoreDeviceResponse(data, snapshot);
+    if (!snapshot.valid) {
+        BOOST_LOG_SEV(lg, warning) << "Error : device event is not a JSON object";
+        return;
+    }
+    ReportSnapshot(snapshot, snapshot.fetched);
+}
+
+void IsodeRadioDriver :: OnEventStream (bool up) {
+
+    // The stream starts with all the params, so the next sweep is a whole interval away.
+    // Once it is gone, poll everything straight away in case a change was missed.
+    if (up)
+        sweep_due = std::chrono::steady_clock::now() + sweep_interval;
+    else
+        poller.SpeedUp(std::chrono::steady_clock::now());
+}
+
+bool IsodeRadioDriver :: DeviceAlerting (void) const {
+    const std::string& alert = GetParamValue(GetSchema().alert_id);
+    return !alert.empty() && alert != "Info";
+}
+
+bool IsodeRadioDriver :: Alerting (void) const {
+    return DeviceAlerting() || OutOfRange();
+}
+
+void IsodeRadioDriver :: SetPollIntervals (const PollIntervals& intervals) {
+    poll_intervals = intervals;
+
+    // A request should give up before the next tick is due, but a device gets at least a
+    // second to answer however short the ticks are.
+    http_timeout = std::max<std::chrono::steady_clock::duration>(intervals.tick - intervals.tick / 5,
+                                                                 std::chrono::seconds(1));
+}
+
+void IsodeRadioDriver :: SetHeartBeatInterval (std::chrono::steady_clock::duration interval) {
+    heartbeat_interval = interval;
+}
+
+void IsodeRadioDriver :: SetDeviceEvents (bool enable, std::chrono::steady_clock::duration sweep) {
+    use_events = enable;
+    sweep_interval = sweep;
+}
+
+void IsodeRadioDriver :: Start (std::chrono::steady_clock::duration first_tick) {
+
+    // Status params change all the time, referenced status params rarely and control params
+    // mostly when RB sets them, which is reported as soon as the device accepts them.
+    std::string target("/device/" + GetDeviceName());
+    status_group = poller.AddGroup(target + "/status", poll_intervals.status, poll_intervals.max_backoff);
+    ref_group = poller.AddGroup(target + "/ref", poll_intervals.ref, poll_intervals.max_backoff);
+    full_group = poller.AddGroup(target, poll_intervals.full, poll_intervals.max_backoff);
+
+    control_pending.Resize(GetSchema().params.Size());
+    control_retried.Resize(GetSchema().params.Size());
+    control_values.assign(GetSchema().params.Size(), std::string());
+
+    // Report initial status of the device params to the RB server. The fetch is a poll of
+    // every group, so the first ticks only poll what falls due after it.
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    HTTPGet(poller.Target(full_group), [this, started](const DeviceSnapshot& snapshot) {
+        if (snapshot.valid)
+            PolledAll(started, true);
+        bool all_params_flag = true;
+        ReportStatusToRB(all_params_flag, snapshot);
+    });
+
+    // Send the first heart beat message, and the next ones every heartbeat_interval.
+    SendHeartBeat(heartbeat_interval);
+    heartbeat_timer.expires_after(std::chrono::steady_clock::duration::zero());
+    ScheduleHeartBeat();
+
+    // Follow the changes the device pushes, if it does. Until they flow the params are
+    // polled as usual.
+    if (use_events) {
+        events.reset(new EventStream(ioc, device_host, device_port, target + "/events",
+                                     [this](const std::string& type, const std::string& data) { OnDeviceEvent(type, data); },
+                                     [this](bool up) { OnEventStream(up); }));
+        events->Start();
+    }
+
+    // Send the updated device status and referenced status parameters to the RB
+    // every poll interval, starting after first_tick.
+    monitor_timer.expires_after(first_tick);
+    monitor_timer.async_wait([this](beast::error_code ec) {
+        if (ec)
+            return;
+        MonitorTick();
+        ScheduleMonitor();
+    });
+}
+
+void IsodeRadioDriver :: Stop (std::function<void()> done) {
+
+    monitor_timer.cancel();
+    heartbeat_timer.cancel();
+    if (events)
+        events->Stop();
+
+    // Values queued while a write is in flight go out once it completes.
+    if (control_in_flight || control_pending.Any()) {
+        using namespace logging::trivial;
+        src::severity_logger<severity_level> lg;
+        BOOST_LOG_SEV(lg, info) << "Device [" << GetDeviceName() << "] waiting for its control writes to complete";
+        on_drained = std::move(done);
+        if (!control_in_flight)
+            WriteControls();
+        return;
+    }
+    done();
+}
+
+DriverHost :: DriverHost (std::string arg_schema_file, std::string arg_std_params_file,
+                          std::chrono::steady_clock::duration max_batch_delay)
+              : schema_file(arg_schema_file),
+                std_params_file(arg_std_params_file),
+                deadband(0),
+                heartbeat_interval(std::chrono::seconds(5)),
+                log_level(logging::trivial::info),
+                stats_interval(std::chrono::seconds(60)),
+                device_events(true),
+                sweep_interval(std::chrono::seconds(60)),
+                control_reader(ioc,
+                               [this](const std::string& rb_msg) { Dispatch(rb_msg); },
+                               [this]() { Drain(); }),
+                frame_writer(ioc, max_batch_delay),
+                stats_timer(ioc),
+                stats_signals(ioc) {
+
+}
+
+void DriverHost :: AddDevice (const std::string& host, const std::string& port, const std::string& name) {
+    entries.push_back(DeviceEntry{host, port, name});
+}
+
+void DriverHost :: SetDeadband (double percent) {
+    deadband = percent;
+}
+
+void DriverHost :: SetPollIntervals (const PollIntervals& intervals) {
+    poll_intervals = intervals;
+}
+
+void DriverHost :: SetHeartBeatInterval (std::chrono::steady_clock::duration interval) {
+    heartbeat_interval = interval;
+}
+
+void DriverHost :: SetDeviceEvents (bool enable, std::chrono::steady_clock::duration sweep) {
+    device_events = enable;
+    sweep_interval = sweep;
+}
+
+void DriverHost :: SetLogLevel (logging::trivial::severity_level level) {
+    log_level = level;
+}
+
+void DriverHost :: SetSchemaCache (const std::string& dir) {
+    schema_cache_dir = dir;
+}
+
+void DriverHost :: AddCompiledSchema (const CompiledSchema& compiled) {
+    compiled_schemas.push_back(compiled);
+}
+
+void DriverHost :: SetStatsInterval (std::chrono::steady_clock::duration interval) {
+    stats_interval = interval;
+}
+
+void DriverHost :: ScheduleStats (void) {
+
+    stats_timer.expires_after(stats_interval);
+    stats_timer.async_wait([this](beast::error_code ec) {
+        if (ec)
+            return;
+
+        using namespace logging::trivial;
+        src::severity_logger<severity_level> lg;
+
+        BOOST_LOG_SEV(lg, info) << PerfStats::Summary();
+        ScheduleStats();
+    });
+}
+
+void DriverHost :: WaitForStatsSignal (void) {
+
+    stats_signals.async_wait([this](beast::error_code ec, int) {
+        if (ec)
+            return;
+
+        using namespace logging::trivial;
+        src::severity_logger<severity_level> lg;
+
+        // stdout carries the frames to RB, so the dump goes to stderr as well as the log.
+        std::string dump = PerfStats::Dump();
+        std::cerr << dump << std::endl;
+        BOOST_LOG_SEV(lg, info) << dump;
+        WaitForStatsSignal();
     });
+}
+
+std::string DriverHost :: GetDeviceName (const std::string& rb_msg) {
 
-    // non-blocking thread to send the updated device status and referenced status parameters
-    // to the RB
-    while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(MONITOR_TIME));
-        // MONITOR_TIME has expired so send a status update.
-        // Get the Device Status Params and Referenced Status Params
-        // from the device and send the same to RB.
-        std::lock_guard<std::mutex> lock_main(mutex_);
-        BOOST_LOG_SEV(lg, info) << "Monitoring device status";
+    static const std::string open_tag("<Device>");
+    static const std::string close_tag("</Device>");
 
-        // Send heartbeat to RB
-        SendHeartBeat(MONITOR_TIME);
+    std::size_t start = rb_msg.find(open_tag);
+    if (start == std::string::npos)
+        return std::string();
+    start += open_tag.size();
 
-        // Send alert message to RB
-        SendAlert();
+    std::size_t end = rb_msg.find(close_tag, start);
+    if (end == std::string::npos)
+        return std::string();
 
-        // Send status of the updated params to RB
-        all_params_flag = false;
-        BOOST_LOG_SEV(lg, info) << "Querying status of the device";
-        ReportStatusToRB(all_params_flag);
+    return rb_msg.substr(start, end - start);
+}
+
+void DriverHost :: Dispatch (const std::string& rb_msg) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    // With a single device every message is for it, as RB only sends us its own messages.
+    if (devices.size() == 1) {
+        devices.begin()->second->SendMsgToDevice(rb_msg);
+        return;
     }
+
+    auto it = devices.find(GetDeviceName(rb_msg));
+    if (it == devices.end()) {
+        BOOST_LOG_SEV(lg, warning) << "Dropping message for unknown device : [" << rb_msg << "]";
+        return;
+    }
+    it->second->SendMsgToDevice(rb_msg);
 }
 
-int main (int argc, char * argv[]) {
+void DriverHost :: Drain (void) {
 
-    boost::program_options::options_description desc
-        ("\nMandatory arguments marked with '*'.\n"
-           "Invocation : <driver_executable> --host <hostname> --port <port> --device_name <device_name> --schema_file <filename> --std_params_file <filename>\nArguments");
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+    BOOST_LOG_SEV(lg, info) << "Input from RB closed, completing the control writes";
+
+    stats_timer.cancel();
+    stats_signals.cancel();
+
+    // Each write gives up after the HTTP timeout at the latest, so this does not hang on a
+    // device that has gone away.
+    auto remaining = std::make_shared<std::size_t>(devices.size() + 1);
+    auto done = [this, remaining]() {
+        if (--*remaining == 0)
+            ioc.stop();
+    };
+    for (auto& device : devices)
+        device.second->Stop(done);
+    done();
+}
 
-    desc.add_options ()
-    ("host", boost::program_options::value<std::string>()->required(),
-                 "* Hostname.")
-    ("port",  boost::program_options::value<std::string>()->required(),
-                 "* Port")
-    ("device_name",  boost::program_options::value<std::string>()->required(),
-                 "* Device Name")
-    ("schema_file",  boost::program_options::value<std::string>()->required(),
-                 "* Schema File")
-    ("std_params_file",  boost::program_options::value<std::string>()->required(),
-                 "* Standard Params File");
+void DriverHost :: Start (void) {
 
-    boost::program_options::variables_map vm;
+    Driver::InitLogging(entries.size() == 1 ? entries.front().name : "isode-demo-radio-driver", log_level);
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
 
+    // Every device is of the type described by the schema, so parse it only once.
+    std::shared_ptr<const DeviceSchema> schema;
     try {
-        boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).run(), vm);
-        boost::program_options::notify(vm);
-    } catch (boost::program_options::error& e) {
-        std::cout << "ERROR: " << e.what() << "\n";
-        std::cout << desc << "\n";
-        return 1;
+        schema = SchemaCache::Load(schema_cache_dir, schema_file, std_params_file, compiled_schemas);
+    } catch (std::exception &e) {
+        std::cout << "Error: " << e.what() << "\n";
+        LogSink::Stop();
+        return;
+    }
+
+    for (const auto& entry : entries) {
+        if (devices.find(entry.name) != devices.end()) {
+            BOOST_LOG_SEV(lg, warning) << "Ignoring duplicate device [" << entry.name << "]";
+            continue;
+        }
+
+        std::unique_ptr<HTTPConnectionPool>& pool = pools[entry.host + ":" + entry.port];
+        if (!pool)
+            pool.reset(new HTTPConnectionPool(ioc, entry.host, entry.port));
+
+        std::unique_ptr<IsodeRadioDriver> driver(new IsodeRadioDriver(ioc, *pool, frame_writer, entry.host, entry.port, entry.name,
+                                                                      schema_file, std_params_file));
+        driver->Load(schema);
+        driver->SetDeadband(deadband);
+        driver->SetPollIntervals(poll_intervals);
+        driver->SetHeartBeatInterval(heartbeat_interval);
+        driver->SetDeviceEvents(device_events, sweep_interval);
+        devices[entry.name] = std::move(driver);
     }
 
-    if (argc < 11) {
-        std::cout << "Error !! Check usage below.\n";
-        std::cout << "Invocation : <driver_executable> --host <hostname> --port <port> --device_name <device_name> --schema_file <filename> --std_params_file <filename>";
-        exit(0);
+    BOOST_LOG_SEV(lg, info) << "Managing [" << devices.size() << "] device(s) over [" << pools.size() << "] device host(s)";
+
+    // Spread the monitor ticks of the devices evenly over the monitor interval rather
+    // than polling them all at once.
+    std::size_t index = 0;
+    for (auto& device : devices) {
+        std::chrono::steady_clock::duration interval = device.second->GetMonitorTime();
+        device.second->Start(interval + interval * index / devices.size());
+        index++;
     }
 
-    // Parse the isode-radio.xml device configuration file and store
-    // the device status and device control params.
-    std :: string host(vm["host"].as<std::string>());
-    std :: string port(vm["port"].as<std::string>());
-    std :: string name(vm["device_name"].as<std::string>());
-    std :: string schemafile(vm["schema_file"].as<std::string>());
-    std :: string stdparamsfile(vm["std_params_file"].as<std::string>());
+    // SIGUSR1 keeps its default action unless there are stats to dump, and Windows has none.
+    if (PerfStats::enabled) {
+        if (stats_interval != std::chrono::steady_clock::duration::zero())
+            ScheduleStats();
+#ifdef SIGUSR1
+        stats_signals.add(SIGUSR1);
+        WaitForStatsSignal();
+#endif
+    }
+
+    // Read messages from stdin and send them to the devices.
+    BOOST_LOG_SEV(lg, info) << "Waiting to receive data...";
+    control_reader.Start();
 
-    IsodeRadioDriver radiodriver(host, port, name, schemafile, stdparamsfile);
+    // Everything runs on the io_context from here, until RB closes stdin.
+    ioc.run();
+    frame_writer.Flush();
 
-    radiodriver.Start();
-    return 0;
-}
\ No newline at end of file
+    if (PerfStats::enabled)
+        BOOST_LOG_SEV(lg, info) << PerfStats::Summary();
+    BOOST_LOG_SEV(lg, info) << "Input from RB closed, exiting.";
+    LogSink::Stop();
+}
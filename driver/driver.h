@@ -1,19 +1,19 @@
+#pragma once
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <set>
 #include <exception>
-#include <string>
-#include <regex>
 #include <algorithm>
 #include <cctype>
 #include <map>
+#include <vector>
 #include <chrono>
 #include <ctime>
-#include <condition_variable>
-#include <mutex>
-#include <thread>
+#include <functional>
+#include <memory>
 
 // Device schema parsing
 #include <boost/property_tree/ptree.hpp>
@@ -26,12 +26,17 @@
 #include <boost/beast/version.hpp>
 #include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/signal_set.hpp>
 
 // Constructing JSON object
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/lexical_cast.hpp>
 
+// Message templates
+#include <boost/algorithm/string/replace.hpp>
+
 // Driver logging
 #include <boost/log/core.hpp>
 #include <boost/log/trivial.hpp>
@@ -43,12 +48,69 @@
 #include <boost/program_options.hpp>
 
 #include "cbor11.h"
+#include "msg_template.h"
+#include "http_pool.h"
+#include "event_stream.h"
+#include "control_reader.h"
+#include "frame_writer.h"
+#include "rb_message.h"
+#include "param_registry.h"
+#include "param_value.h"
+#include "json_reader.h"
+#include "poll_scheduler.h"
+#include "log_sink.h"
+#include "perf_stats.h"
+#include "schema_cache.h"
 
 #ifdef _WIN32
 #include <io.h>
 #include <fcntl.h>
 #endif
 
+// The outcome of one fetch of the device parameters. The values themselves are stored
+// in the driver as the response is decoded, see Driver::StoreDeviceResponse. Everything
+// that reports on the device during a monitor tick (alert, status diff, operational
+// status) reads the same values, so the device is queried only once per tick.
+struct DeviceSnapshot {
+    bool valid;                                      // False if the device did not respond
+    std::size_t changed;                             // Number of params whose value changed
+    std::size_t unchecked;                           // Of those, params without bounds to check them against
+    bool not_modified;                               // The device answered 304, the values held are still current
+    std::chrono::steady_clock::time_point requested; // When the device was asked for it, its values are no older
+    std::chrono::steady_clock::time_point fetched;   // When the snapshot was taken
+
+    DeviceSnapshot() : valid(false), changed(0), unchecked(0), not_modified(false) {}
+};
+
+// The params of a device type as described by its Abstract Device Specification and the
+// standard parameters list. It does not depend on the device instance, so the drivers of
+// several devices of the same type share one.
+struct DeviceSchema {
+    std::string device_type;       // Device type
+    std::string device_family;     // Device family
+
+    ParamRegistry params;                  // Every device (status/control/std) param, with its type
+    std::vector<ParamId> tracked_params;   // Params (device status/control/referenced status) the driver keeps a value for
+    std::vector<std::uint8_t> skip_status; // Indexed by param ID, non zero for params not sent as status (Alert, AlertMessage, DeviceTypeHash)
+    std::vector<std::string> status_open;  // Indexed by param ID, status message text between <DeviceType> and the value
+    std::vector<std::string> status_close; // Indexed by param ID, status message text after the value
+
+    // IDs of the params the driver itself reports on.
+    ParamId heartbeat_id;
+    ParamId status_id;
+    ParamId alert_id;
+    ParamId alert_message_id;
+
+    // Parse the XML device schema and the standard parameters.
+    static std::shared_ptr<const DeviceSchema> Load(const std::string& schema_file, const std::string& std_params_file);
+
+    // Return the type of a param, or "" if it is not known.
+    const std::string& GetParamType(const std::string& name) const;
+
+    // Fill status_open and status_close from the names and types of the params.
+    void BuildStatusFragments(void);
+};
+
 class Driver {
 
     private:
@@ -59,11 +121,42 @@ class Driver {
     std::string schema_file;       // Device schema file
     std::string std_params_file;   // Device standard parameters file
 
-    std::map<std::string, std::string> param_name_val;     // Map to store param (device status/control/std params) and its value
-    std::map<std::string, std::string> param_name_type;    // Map to store device (status/control/std) param and its type.
+    std::shared_ptr<const DeviceSchema> schema;            // Params of the device type, possibly shared with other drivers
+    std::vector<ParamValue> param_values;     // Latest value of each param reported by the device, indexed by param ID
+    ParamBitmap out_of_range;                 // Bounded Integer params whose value is outside of their bounds
+    std::vector<std::uint8_t> param_reported; // Indexed by param ID, non zero once the device has reported the param
+    std::vector<std::chrono::steady_clock::time_point> param_stored;   // Indexed by param ID, 'requested' of the value held
+    ParamBitmap param_dirty;                  // Params to be sent with the next status update
+    std::vector<long long> param_deadband;    // Indexed by param ID, smallest change of an Integer param worth sending, 0 for any change
+    std::vector<long long> param_sent;        // Indexed by param ID, value of a param with a deadband last sent to RB
+    ParamBitmap param_sent_valid;             // Params with a deadband whose param_sent is set
+    std::vector<std::uint8_t> param_known;    // Indexed by param ID, non zero if SendStatus only sends changes of the param
+    std::string unescaped;                    // Reused for JSON strings containing escape sequences
 
-    std::set<std::string> ptype;              // Set to store the parameter type
     std::string status_msg_format;            // Generic format of the status message to be sent to RB server
+    std::string status_head;                  // Start of every message of this device, up to </DeviceType>
+
+    MessageTemplate status_template;          // status_msg_format parsed into segments (param name, type, value)
+    MessageTemplate alert_template;           // Alert message (alert type, alert message)
+    MessageTemplate operational_template;     // Operational status message (status)
+    std::string msg_buffer;                   // Reused for every rendered message
+    cbor::encoder frame_buffer;               // Reused for every CBOR frame written to stdout
+    FrameWriter* frame_writer;                // Batches frames, if set
+
+    // Return false if the stored value of a param with a deadband has moved by at least the
+    // deadband from the value last sent, or out of the param's bounds.
+    bool WithinDeadband(ParamId id) const;
+
+    // Send the stored value of one param to RB.
+    void SendParamStatus(ParamId id);
+
+    // Store a value of a param and check it against the bounds of the param. Returns true
+    // if the value changed, see ParamValue::Assign.
+    bool StoreValue(ParamId id, boost::string_view value);
+
+    // Set the category (CONTROL / REFCONTROL) and type of a param named in a control message.
+    // Both are left alone for an unknown param.
+    void ClassifyParam(const std::string& param_name, std::string& param_category, std::string& param_type) const;
 
     public:
 
@@ -75,8 +168,22 @@ class Driver {
     std::string GetDeviceName(void);
     std::string GetStatusMsgFormat(void);
 
-    // Initialize driver logging.
-    void InitLogging(void);
+    // The schema passed to Load().
+    const DeviceSchema& GetSchema(void) const { return *schema; }
+
+    // Render a message into the shared message buffer. The returned reference is valid
+    // until the next Format call.
+    const std::string& FormatStatus(const std::string& name, const std::string& type, const std::string& value);
+    const std::string& FormatAlert(const std::string& alert_type, const std::string& alert_message);
+    const std::string& FormatOperationalStatus(const std::string& status);
+
+    // Render a Warning naming the params outside of their bounds, with their values and
+    // bounds divided by their multiplier, e.g. "Parameters beyond range : Temperature 250 (-20 to 200)".
+    const std::string& FormatRangeAlert(void);
+
+    // Initialize driver logging, once per process. Logs of at least 'min_level' go to
+    // /tmp/<log_name>_<N>.log, written by a background thread, see LogSink.
+    static void InitLogging(const std::string& log_name, boost::log::trivial::severity_level min_level);
 
     // This functions parses the message received from RB server and saves the param category, name, type
     // and value in the passed arguments.
@@ -86,20 +193,52 @@ class Driver {
     // Parse the XML device schema and store the device status & control params.
     void Load();
 
-    // Send heartbeat message to RB
-    void SendHeartBeat(int MONITOR_TIME);
+    // Use a schema that has already been loaded.
+    void Load(std::shared_ptr<const DeviceSchema> schema);
+
+    // Only report a change of an Integer param with bounds in the schema once it moves the
+    // value by at least 'percent' of the range between the bounds. With 0 every change is
+    // reported. Must be called after Load().
+    void SetDeadband(double percent);
+
+    // Send heartbeat message to RB, announcing the next one 'interval' from now.
+    void SendHeartBeat(std::chrono::steady_clock::duration interval);
 
     // Create and send CBOR message to RB
     void SendCBOR(const std::string& msg);
 
+    // Queue frames on 'writer' rather than writing each one to stdout straight away.
+    void SetFrameWriter(FrameWriter* writer);
+
+    // The writer frames are queued on, or nullptr if they are written straight away.
+    FrameWriter* GetFrameWriter(void) const { return frame_writer; }
+
     // Update the status of the device when it stops responding
     void UpdateDeviceParam(const std::string& name, const std::string& val);
 
     // Return a parameter value.
     std::string GetParamValue(const std::string& param);
+    const std::string& GetParamValue(ParamId id) const;
+
+    // True while the value of a bounded Integer param is outside of its bounds.
+    bool OutOfRange(void) const { return out_of_range.Any(); }
+
+    // Decode a JSON response of the device in place and store the values of the params
+    // the schema knows, marking the ones that changed by more than their deadband. Other
+    // params are skipped, as are params holding a value newer than the snapshot, e.g. one
+    // pushed by the device while a poll was under way. Sets the number of params whose value changed, deadband or not,
+    // in the snapshot. Returns false if the response is not a JSON object.
+    bool StoreDeviceResponse(boost::string_view response, DeviceSnapshot& snapshot);
+
+    // Store a value the device has accepted for a param and send it to RB.
+    void ReportParamValue(ParamId id, const std::string& value);
 
-    // Send the status of all params to RB.
-    void SendStatus(std::map<std::string, std::string>& current_status, bool send_all_param);
+    // Send the status of all params to RB, or only of those marked as changed since they
+    // were last sent. The latter only visits the marked params.
+    void SendStatus(bool send_all_param);
+
+    // True if a param is marked to be sent by the next SendStatus(false).
+    bool ParamsChanged(void) const { return param_dirty.Any(); }
 };
 
 class IsodeRadioDriver : public Driver {
@@ -108,36 +247,229 @@ class IsodeRadioDriver : public Driver {
     std::string device_host;       // Device host
     std::string device_port;       // Device port
 
-    boost::asio::io_context ioc;   // io_context is required for all I/O
+    boost::asio::io_context& ioc;  // io_context is required for all I/O, the driver runs entirely on it
+    HTTPConnectionPool& http_pool; // Keep-alive connections to the device host
     int version;                   // HTTP protocol version for sending GET / POST to web device.
 
-    unsigned int MONITOR_TIME;     // Time in seconds to monitor the device status params and referenced status params
+    std::chrono::steady_clock::duration heartbeat_interval;   // Time between heartbeats
+    std::chrono::steady_clock::duration http_timeout;         // Deadline for each HTTP request to the device
+    std::map<std::string, std::string> etags;                 // Keyed by target, ETag of the values held from it
+
+    boost::asio::steady_timer monitor_timer;   // Drives the monitor tick
+    boost::asio::steady_timer heartbeat_timer; // Drives the heartbeat, whatever the device is doing
+    bool fetch_in_progress;                    // A monitor fetch has not completed yet
+
+    PollIntervals poll_intervals;              // Intervals of the param groups
+    PollScheduler poller;                      // Param groups and when they are due
+    std::size_t status_group;                  // Index of the device status params in poller
+    std::size_t ref_group;                     // Index of the referenced status params in poller
+    std::vector<std::size_t> due_groups;       // Groups polled by the current monitor tick
+    std::chrono::steady_clock::time_point tick_time;   // When the current monitor tick was due
+    std::string last_alert;                    // Alert level seen by the previous monitor tick
+
+    bool use_events;                           // Follow the device's event stream, see SetDeviceEvents()
+    std::unique_ptr<EventStream> events;       // Changes pushed by the device, while it offers them
+    std::size_t full_group;                    // Index of all the device params in poller
+    std::chrono::steady_clock::duration sweep_interval;   // Time between polls of all params while events flow
+    std::chrono::steady_clock::time_point sweep_due;      // When the next of those is due
+
+    ParamBitmap control_pending;               // Control params with a value waiting to be written to the device
+    std::vector<std::string> control_values;   // Indexed by param ID, the value waiting to be written
+    ParamBitmap control_retried;               // Control params whose value failed to be written once already
+    bool control_in_flight;                    // A control POST has not completed yet
+    std::function<void()> on_drained;          // Called once no control write is left, see Stop()
+    unsigned long long control_count;          // Number of control messages received from RB
+    unsigned long long control_post_count;     // Number of control POSTs sent to the device
+
+    // Wait for the next monitor tick.
+    void ScheduleMonitor(void);
+
+    // Query the param groups that are due.
+    void MonitorTick(void);
+
+    // Wait for the next heartbeat and send it.
+    void ScheduleHeartBeat(void);
+
+    // Fetch due_groups[index] and the groups after it, one after the other.
+    void PollGroup(std::size_t index);
+
+    // Record a poll of all the params, which is a poll of the status and referenced status
+    // params as well.
+    void PolledAll(std::chrono::steady_clock::time_point when, bool changed);
+
+    // Report on the device once the due groups have been fetched.
+    void FinishPoll(const DeviceSnapshot& snapshot);
+
+    // Send the alert and the changed params of a snapshot to RB, from a poll started at
+    // 'when' or from an event.
+    void ReportSnapshot(const DeviceSnapshot& snapshot, std::chrono::steady_clock::time_point when);
+
+    // Store and report the params of an event pushed by the device.
+    void OnDeviceEvent(const std::string& type, const std::string& data);
+
+    // The event stream came up or went down.
+    void OnEventStream(bool up);
+
+    // True while the device reports an alert above Info.
+    bool DeviceAlerting(void) const;
+
+    // True while the device reports an alert above Info or a param is out of its bounds.
+    bool Alerting(void) const;
+
+    // Queue a new value of a control param, replacing any value of the same param not
+    // written yet, and write the queue unless a write is in flight.
+    void QueueControl(ParamId id, const std::string& value);
+
+    // Write every queued control value to the device in one POST, and confirm the values
+    // to RB once the device has accepted them. Values the device did not accept are queued
+    // again once, unless a newer value of the param is already queued.
+    void WriteControls(void);
 
     public:
 
-    IsodeRadioDriver(std::string device_host, std::string device_port, std::string device_name,
+    typedef std::function<void(const DeviceSnapshot&)> SnapshotHandler;
+    typedef std::function<void(bool)> PostHandler;
+
+    // The io_context, the connection pool and the frame writer may be shared with the
+    // drivers of other devices.
+    IsodeRadioDriver(boost::asio::io_context& ioc, HTTPConnectionPool& http_pool, FrameWriter& frame_writer,
+                     std::string device_host, std::string device_port, std::string device_name,
                      std::string schema_file, std::string std_params_file);
 
-    // Run the driver program.
-    void Start(void);
+    // Report the initial status of the device and start monitoring it. The first monitor
+    // tick is delayed by 'first_tick', so that devices sharing an io_context can be
+    // spread over the monitor interval. Load() must have been called.
+    void Start(std::chrono::steady_clock::duration first_tick);
+
+    // Stop monitoring the device and call 'done' once the control values queued or in
+    // flight have been written to the device, or given up on.
+    void Stop(std::function<void()> done);
+
+    std::chrono::steady_clock::duration GetMonitorTime(void) const { return poll_intervals.tick; }
+
+    // Set how often the param groups are polled. Must be called before Start().
+    void SetPollIntervals(const PollIntervals& intervals);
+
+    // Set the time between heartbeats. Must be called before Start().
+    void SetHeartBeatInterval(std::chrono::steady_clock::duration interval);
+
+    // Follow the changes the device pushes on /device/<name>/events, if it does. While
+    // they flow, polling is reduced to all the params every 'sweep', to catch anything
+    // an event missed. Must be called before Start().
+    void SetDeviceEvents(bool enable, std::chrono::steady_clock::duration sweep);
 
     // Send the message received from the RB to the device.
     void SendMsgToDevice(const std::string& rb_msg);
 
-    // Report status of the device back to RB.
+    // Report status of the device back to RB, either from a fresh fetch or from a
+    // snapshot already taken during this tick.
     void ReportStatusToRB(bool all_params_flag);
+    void ReportStatusToRB(bool all_params_flag, const DeviceSnapshot& snapshot);
 
     // Send an HTTP Request ( Get / Post ) to the rb devices based on message received from 
     // the red-black server.
     void SendHTTPRequest(const std::string& rb_msg);
 
     // Send HTTP Get request to the rb device and get the status using device status parameters.
-    bool HTTPGet(const std::string& target_device, std::map<std::string, std::string>& status_param_val);
+    // The handler is called on the io_context with the snapshot, which is invalid if the
+    // device did not respond in time. A target fetched before is asked for only if it has
+    // changed since, by its ETag, and a 304 leaves the values alone.
+    void HTTPGet(const std::string& target_device, SnapshotHandler handler);
 
-    // Send HTTP Post request to the rb device to modify device control parameters.
-    bool HTTPPost(const std::string& target_device, const std::string& param, const std::string& value);
+    // Send HTTP Post request to the rb device to modify device control parameters, given
+    // as the members of a flat ptree. The handler is called on the io_context with the outcome,
+    // which is false unless the device answered with a 2xx status.
+    void HTTPPost(const std::string& target_device, const boost::property_tree::ptree& params,
+                  PostHandler handler);
 
     // Send alert message to RB
-    void SendAlert(void);
+    void SendAlert(const DeviceSnapshot& snapshot);
+
+};
+
+// Runs the drivers of one or more devices in one process. The device schema is loaded
+// and logging is set up only once, all drivers share one io_context and one keep-alive
+// connection pool per device host, and the CBOR channel on stdin/stdout is shared with
+// control messages routed by their <Device> element.
+class DriverHost {
+
+    private:
+    struct DeviceEntry {
+        std::string host;
+        std::string port;
+        std::string name;
+    };
+
+    std::string schema_file;       // Device schema file
+    std::string std_params_file;   // Device standard parameters file
+    std::vector<DeviceEntry> entries;
+    double deadband;               // Deadband of bounded Integer params, percent of their range
+    PollIntervals poll_intervals;  // Intervals of the param groups of every driver
+    std::chrono::steady_clock::duration heartbeat_interval;   // Time between the heartbeats of every driver
+    boost::log::trivial::severity_level log_level;            // Lowest severity logged
+    std::chrono::steady_clock::duration stats_interval;       // Time between stats summaries, 0 for none
+    std::string schema_cache_dir;  // Where compiled schema images are kept, "" for none
+    bool device_events;            // Follow the event streams of the devices
+    std::chrono::steady_clock::duration sweep_interval;       // Time between full polls while events flow
+    std::vector<CompiledSchema> compiled_schemas;   // Schemas built into the driver, see device_profile.h
+
+    boost::asio::io_context ioc;   // Shared by every driver
+    ControlReader control_reader;  // Control messages from RB on stdin
+    FrameWriter frame_writer;      // Status messages to RB on stdout
+    boost::asio::steady_timer stats_timer;    // Logs the stats summary
+    boost::asio::signal_set stats_signals;    // SIGUSR1 dumps the stats, where there is one
+
+    std::map<std::string, std::unique_ptr<HTTPConnectionPool>> pools;   // Keyed by "host:port"
+    std::map<std::string, std::unique_ptr<IsodeRadioDriver>> devices;   // Keyed by device name
+
+    // Route a control message to the driver of the device it names.
+    void Dispatch(const std::string& rb_msg);
+
+    // RB closed stdin : stop every driver and the io_context once their control writes are done.
+    void Drain(void);
+
+    // Log the stats summary every stats_interval, and the full stats on SIGUSR1.
+    void ScheduleStats(void);
+    void WaitForStatsSignal(void);
+
+    public:
+
+    // Frames sent to RB are held for at most 'max_batch_delay' so they can be written together.
+    DriverHost(std::string schema_file, std::string std_params_file,
+               std::chrono::steady_clock::duration max_batch_delay);
+
+    // Add a device to be managed. Must be called before Start().
+    void AddDevice(const std::string& host, const std::string& port, const std::string& name);
+
+    // Set the deadband of every driver, see Driver::SetDeadband(). Must be called before Start().
+    void SetDeadband(double percent);
+
+    // Set the poll intervals of every driver. Must be called before Start().
+    void SetPollIntervals(const PollIntervals& intervals);
+
+    // Set the heartbeat interval of every driver. Must be called before Start().
+    void SetHeartBeatInterval(std::chrono::steady_clock::duration interval);
+
+    // Set whether every driver follows the event stream of its device, see
+    // IsodeRadioDriver::SetDeviceEvents(). Must be called before Start().
+    void SetDeviceEvents(bool enable, std::chrono::steady_clock::duration sweep);
+
+    // Set the lowest severity logged. Must be called before Start().
+    void SetLogLevel(boost::log::trivial::severity_level level);
+
+    // Set the time between stats summaries in the log, 0 for none. Must be called before Start().
+    void SetStatsInterval(std::chrono::steady_clock::duration interval);
+
+    // Keep a compiled image of the schema in 'dir', see SchemaCache. Must be called before Start().
+    void SetSchemaCache(const std::string& dir);
+
+    // Use a schema built into the driver when the schema files are the ones it was
+    // generated from. Must be called before Start().
+    void AddCompiledSchema(const CompiledSchema& compiled);
+
+    // Load the schema, start every driver and run until RB closes stdin.
+    void Start(void);
 
+    // Return the text of the <Device> element of a control message, or "" if there is none.
+    static std::string GetDeviceName(const std::string& rb_msg);
 };
@@ -0,0 +1,256 @@
+#include "event_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <boost/log/trivial.hpp>
+#include <boost/log/sources/severity_logger.hpp>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+namespace logging = boost::log;
+namespace src = boost::log::sources;
+
+using net::ip::tcp;
+
+namespace {
+
+// A line longer than this is not an event of a device, give up on the stream.
+const std::size_t max_line = 1024 * 1024;
+
+const std::chrono::steady_clock::duration first_retry_delay = std::chrono::seconds(1);
+
+}
+
+EventStream :: EventStream(net::io_context& arg_ioc, const std::string& arg_host, const std::string& arg_port,
+                           const std::string& arg_target, EventHandler arg_on_event, StateHandler arg_on_state,
+                           duration arg_idle_timeout, duration arg_max_retry_delay)
+               : ioc(arg_ioc), host(arg_host), port(arg_port), target(arg_target),
+                 on_event(std::move(arg_on_event)), on_state(std::move(arg_on_state)),
+                 resolver(arg_ioc), retry_timer(arg_ioc),
+                 idle_timeout(arg_idle_timeout), retry_delay(first_retry_delay), max_retry_delay(arg_max_retry_delay),
+                 up(false), stopped(true), connect_count(0), event_count(0) {
+
+    req = http::request<http::empty_body>{http::verb::get, target, 11};
+    req.set(http::field::host, host);
+    req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+    req.set(http::field::accept, "text/event-stream");
+    req.set(http::field::cache_control, "no-cache");
+    req.keep_alive(true);
+}
+
+void EventStream :: Start(void) {
+    stopped = false;
+    Connect();
+}
+
+void EventStream :: Stop(void) {
+
+    stopped = true;
+    retry_timer.cancel();
+    resolver.cancel();
+    if (stream) {
+        beast::error_code ec;
+        stream->socket().shutdown(tcp::socket::shutdown_both, ec);
+        stream->close();
+    }
+    if (up) {
+        up = false;
+        on_state(false);
+    }
+}
+
+void EventStream :: Connect(void) {
+
+    // Look the host up again on each connection, the device may have moved.
+    resolver.async_resolve(host, port, [this](beast::error_code ec, tcp::resolver::results_type results) {
+        if (stopped)
+            return;
+        if (ec) {
+            Retry(retry_delay, "Can't resolve device host : " + ec.message());
+            return;
+        }
+
+        stream.reset(new beast::tcp_stream(ioc));
+        stream->expires_after(idle_timeout);
+        stream->async_connect(results, [this](beast::error_code ec, tcp::endpoint) {
+            if (stopped)
+                return;
+            if (ec) {
+                Retry(retry_delay, "Can't connect : " + ec.message());
+                return;
+            }
+            http::async_write(*stream, req, [this](beast::error_code ec, std::size_t) {
+                if (stopped)
+                    return;
+                if (ec) {
+                    Retry(retry_delay, "Can't send request : " + ec.message());
+                    return;
+                }
+                ReadHeader();
+            });
+        });
+    });
+}
+
+void EventStream :: ReadHeader(void) {
+
+    // The body goes on for as long as the stream is up, so there is no limit to its size.
+    // Boost 1.74 compares a Content-Length with an unset limit, which always fails, hence
+    // the largest limit rather than none.
+    parser.reset(new http::response_parser<http::buffer_body>());
+    parser->body_limit(std::numeric_limits<std::uint64_t>::max());
+
+    stream->expires_after(idle_timeout);
+    http::async_read_header(*stream, buffer, *parser, [this](beast::error_code ec, std::size_t) {
+        if (stopped)
+            return;
+        if (ec) {
+            Retry(retry_delay, "Can't read response : " + ec.message());
+            return;
+        }
+
+        // A device without the endpoint answers 404, which is not going to change soon.
+        const auto& res = parser->get();
+        if (res.result() != http::status::ok ||
+            !boost::string_view(res[http::field::content_type]).starts_with("text/event-stream")) {
+            Retry(max_retry_delay, "Device does not send events, status : " + std::to_string(res.result_int()));
+            return;
+        }
+
+        using namespace logging::trivial;
+        src::severity_logger<severity_level> lg;
+        BOOST_LOG_SEV(lg, info) << "Receiving events from device host : [" << host << ":" << port
+                                << "], target : [" << target << "]";
+
+        up = true;
+        retry_delay = first_retry_delay;
+        connect_count++;
+        on_state(true);
+        ReadBody();
+    });
+}
+
+void EventStream :: ReadBody(void) {
+
+    parser->get().body().data = body;
+    parser->get().body().size = sizeof(body);
+
+    // The device sends at least a comment every so often, silence means it is gone.
+    stream->expires_after(idle_timeout);
+    http::async_read_some(*stream, buffer, *parser, [this](beast::error_code ec, std::size_t) {
+        if (stopped)
+            return;
+        // The body buffer is full, which is what it is there for.
+        if (ec == http::error::need_buffer)
+            ec = {};
+        if (ec) {
+            Retry(retry_delay, "Event stream lost : " + ec.message());
+            return;
+        }
+
+        Parse(body, sizeof(body) - parser->get().body().size);
+        if (stopped)
+            return;
+        if (line.size() > max_line) {
+            Retry(retry_delay, "Event stream line too long");
+            return;
+        }
+        if (parser->is_done()) {
+            Retry(retry_delay, "Event stream ended by the device");
+            return;
+        }
+        ReadBody();
+    });
+}
+
+void EventStream :: Retry(duration delay, const std::string& reason) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+    BOOST_LOG_SEV(lg, warning) << reason << ", connecting again in ["
+                               << std::chrono::duration_cast<std::chrono::milliseconds>(delay).count() << "] ms";
+
+    if (stream) {
+        beast::error_code ec;
+        stream->socket().shutdown(tcp::socket::shutdown_both, ec);
+        stream->close();
+    }
+    buffer.consume(buffer.size());
+    line.clear();
+    event_type.clear();
+    event_data.clear();
+
+    if (up) {
+        up = false;
+        on_state(false);
+    }
+
+    retry_delay = std::min(retry_delay * 2, max_retry_delay);
+    retry_timer.expires_after(delay);
+    retry_timer.async_wait([this](beast::error_code ec) {
+        if (ec || stopped)
+            return;
+        Connect();
+    });
+}
+
+void EventStream :: Parse(const char* data, std::size_t size) {
+
+    // Lines end with "\n" or "\r\n", and may be split over reads.
+    const char* end = data + size;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        if (!newline) {
+            line.append(data, end);
+            return;
+        }
+
+        boost::string_view text(data, newline - data);
+        if (!line.empty()) {
+            line.append(data, newline);
+            text = line;
+        }
+        if (!text.empty() && text.back() == '\r')
+            text.remove_suffix(1);
+        ParseLine(text);
+        line.clear();
+        data = newline + 1;
+    }
+}
+
+void EventStream :: ParseLine(boost::string_view text) {
+
+    // An empty line ends the event.
+    if (text.empty()) {
+        if (!event_data.empty()) {
+            event_data.pop_back();
+            event_count++;
+            on_event(event_type.empty() ? std::string("message") : event_type, event_data);
+        }
+        event_type.clear();
+        event_data.clear();
+        return;
+    }
+
+    // A comment, e.g. a keepalive.
+    if (text.front() == ':')
+        return;
+
+    boost::string_view field = text.substr(0, text.find(':'));
+    boost::string_view value = text.substr(field.size());
+    if (!value.empty())
+        value.remove_prefix(1);
+    if (!value.empty() && value.front() == ' ')
+        value.remove_prefix(1);
+
+    // Data of several lines is joined by newlines. Other fields are of no use here.
+    if (field == "event") {
+        event_type.assign(value.data(), value.size());
+    } else if (field == "data") {
+        event_data.append(value.data(), value.size());
+        event_data += '\n';
+    }
+}
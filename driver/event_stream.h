@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/utility/string_view.hpp>
+
+// Follows a stream of server-sent events (text/event-stream) from a device over a
+// connection of its own, e.g. GET /device/<name>/events of isode-device-web-manager :
+//
+//      event: params
+//      data: {"Temperature":"120"}
+//
+//      : keepalive
+//
+// Each complete event is passed to the event handler with its type and data. The state
+// handler is called when the stream comes up and when it goes down, so the caller can
+// poll the device while there are no events. A stream that fails, ends, or stays silent
+// for longer than the idle timeout is connected again after a delay, which doubles on
+// each failure up to a maximum. A device without the endpoint is tried again after the
+// maximum delay.
+//
+// All operations are asynchronous and run on the io_context passed in.
+class EventStream {
+
+    public:
+    typedef std::chrono::steady_clock::duration duration;
+    typedef std::function<void(const std::string& type, const std::string& data)> EventHandler;
+    typedef std::function<void(bool up)> StateHandler;
+
+    private:
+    boost::asio::io_context& ioc;
+    std::string host;
+    std::string port;
+    std::string target;
+    EventHandler on_event;
+    StateHandler on_state;
+
+    boost::asio::ip::tcp::resolver resolver;
+    std::unique_ptr<boost::beast::tcp_stream> stream;
+    boost::beast::flat_buffer buffer;             // Read buffer, must persist with the stream
+    boost::beast::http::request<boost::beast::http::empty_body> req;
+    std::unique_ptr<boost::beast::http::response_parser<boost::beast::http::buffer_body>> parser;
+    char body[4096];                              // Body of the response is read into this, piece by piece
+
+    std::string line;          // Start of a line not complete yet
+    std::string event_type;    // Fields of the event being read
+    std::string event_data;
+
+    boost::asio::steady_timer retry_timer;
+    duration idle_timeout;     // Longest silence before the stream is given up
+    duration retry_delay;      // Delay before the next connection attempt
+    duration max_retry_delay;
+    bool up;
+    bool stopped;
+
+    unsigned long long connect_count;    // Number of times the stream came up
+    unsigned long long event_count;      // Number of events received
+
+    // Steps of the stream : resolve and connect, write the request, read the header and
+    // then the body for as long as the device keeps sending it.
+    void Connect(void);
+    void ReadHeader(void);
+    void ReadBody(void);
+
+    // Close the connection and connect again after 'delay'.
+    void Retry(duration delay, const std::string& reason);
+
+    // Split the body into lines and the lines into events.
+    void Parse(const char* data, std::size_t size);
+    void ParseLine(boost::string_view text);
+
+    public:
+
+    EventStream(boost::asio::io_context& ioc, const std::string& host, const std::string& port,
+                const std::string& target, EventHandler on_event, StateHandler on_state,
+                duration idle_timeout = std::chrono::seconds(45),
+                duration max_retry_delay = std::chrono::seconds(60));
+
+    // Connect and keep the stream up until Stop().
+    void Start(void);
+    void Stop(void);
+
+    // True while the device is sending events.
+    bool Up(void) const { return up; }
+
+    unsigned long long GetConnectCount(void) const { return connect_count; }
+    unsigned long long GetEventCount(void) const { return event_count; }
+};
@@ -0,0 +1,81 @@
+#include "frame_writer.h"
+
+#include <cstdio>
+
+#include <boost/asio/post.hpp>
+
+namespace net = boost::asio;
+
+FrameWriter :: FrameWriter(net::io_context& arg_ioc, std::chrono::steady_clock::duration arg_max_delay,
+                           std::size_t arg_max_batch, std::FILE* arg_out)
+               : ioc(arg_ioc), flush_timer(arg_ioc), max_delay(arg_max_delay), max_batch(arg_max_batch), out(arg_out),
+                 flush_scheduled(false), open_batches(0), frame_count(0), write_count(0) {
+
+}
+
+FrameWriter :: ~FrameWriter() {
+    Flush();
+}
+
+void FrameWriter :: Write(boost::string_view msg) {
+
+    pending.write_embedded_string(msg.data(), msg.size());
+    frame_count++;
+
+    if (pending.size() >= max_batch) {
+        Flush();
+        return;
+    }
+    if (flush_scheduled)
+        return;
+    flush_scheduled = true;
+
+    // Outside of a batch, a posted flush runs once the current handler has queued all
+    // its frames. Inside one, the timer bounds how long the first frame waits.
+    if (open_batches == 0 || max_delay == std::chrono::steady_clock::duration::zero()) {
+        net::post(ioc, [this] {
+            if (flush_scheduled)
+                Flush();
+        });
+        return;
+    }
+    flush_timer.expires_after(max_delay);
+    flush_timer.async_wait([this](boost::system::error_code ec) {
+        if (!ec && flush_scheduled)
+            Flush();
+    });
+}
+
+void FrameWriter :: BeginBatch(void) {
+    open_batches++;
+}
+
+void FrameWriter :: EndBatch(void) {
+
+    if (open_batches > 0)
+        open_batches--;
+    if (open_batches == 0 && pending.size() != 0) {
+        // Write once the handler ending the batch has queued its frames.
+        flush_timer.cancel();
+        flush_scheduled = true;
+        net::post(ioc, [this] {
+            if (flush_scheduled)
+                Flush();
+        });
+    }
+}
+
+void FrameWriter :: Flush(void) {
+
+    if (flush_scheduled) {
+        flush_scheduled = false;
+        flush_timer.cancel();
+    }
+    if (pending.size() == 0)
+        return;
+
+    fwrite(pending.data(), 1, pending.size(), out);
+    fflush(out);
+    write_count++;
+    pending.clear();
+}
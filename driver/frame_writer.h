@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include "cbor11.h"
+
+// Collects the CBOR frames sent to Red/Black on stdout and writes them out together.
+// Every frame queued while one handler runs on the io_context, e.g. the full parameter
+// dump of SendParameters, goes out in a single write once the handler returns.
+//
+// An operation spanning several handlers, such as a monitor tick that sends the heartbeat
+// and then reports on the device once it answers, can hold its frames back between
+// BeginBatch() and EndBatch(). No frame is held for longer than max_delay though, and
+// with a max_delay of zero frames are never held past the end of the handler.
+class FrameWriter {
+
+    private:
+    boost::asio::io_context& ioc;
+    boost::asio::steady_timer flush_timer;          // Bounds how long a frame may wait
+    std::chrono::steady_clock::duration max_delay;  // Upper bound on the batching delay
+    std::size_t max_batch;                          // Write straight away once this many bytes are queued
+    std::FILE* out;                                 // Where the frames go, stdout but for benchmarks
+
+    cbor::encoder pending;         // Encoded frames not written yet
+    bool flush_scheduled;          // A flush is posted or the timer is running
+    unsigned int open_batches;     // Operations holding frames back
+
+    unsigned long long frame_count;   // Number of frames queued
+    unsigned long long write_count;   // Number of writes to stdout
+
+    public:
+
+    FrameWriter(boost::asio::io_context& ioc, std::chrono::steady_clock::duration max_delay,
+                std::size_t max_batch = 64 * 1024, std::FILE* out = stdout);
+    ~FrameWriter();
+
+    // Queue a message, wrapped in a CBOR frame, to be written to stdout.
+    void Write(boost::string_view msg);
+
+    // Hold frames back until the matching EndBatch(), or until max_delay has passed.
+    void BeginBatch(void);
+    void EndBatch(void);
+
+    // Write all queued frames now.
+    void Flush(void);
+
+    unsigned long long GetFrameCount(void) const { return frame_count; }
+    unsigned long long GetWriteCount(void) const { return write_count; }
+};
@@ -0,0 +1,149 @@
+#include "http_pool.h"
+
+#include <boost/asio/steady_timer.hpp>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+
+using net::ip::tcp;
+
+HTTPConnectionPool :: HTTPConnectionPool(net::io_context& arg_ioc, const std::string& arg_host,
+                                         const std::string& arg_port, std::size_t arg_max_idle)
+                      : ioc(arg_ioc), host(arg_host), port(arg_port), max_idle(arg_max_idle),
+                        resolve_count(0), connect_count(0), reuse_count(0) {
+
+}
+
+void HTTPConnectionPool :: AsyncRequest(std::shared_ptr<HTTPExchange> exchange,
+                                        std::chrono::steady_clock::duration timeout,
+                                        Handler handler) {
+
+    OperationPtr op = std::make_shared<Operation>(ioc);
+    op->exchange = exchange;
+    op->handler = std::move(handler);
+    op->deadline = std::chrono::steady_clock::now() + timeout;
+
+    exchange->req.keep_alive(true);
+
+    if (!idle.empty()) {
+        op->conn = std::move(idle.back());
+        idle.pop_back();
+        op->reused = true;
+        Send(op);
+        return;
+    }
+    Connect(op);
+}
+
+void HTTPConnectionPool :: Connect(OperationPtr op) {
+
+    op->reused = false;
+
+    if (!endpoints.empty()) {
+        DoConnect(op);
+        return;
+    }
+
+    // Look up the domain name only once, the endpoint is dropped again if connecting fails.
+    // The resolver has no deadline of its own, so cancel it when the request expires.
+    auto timer = std::make_shared<net::steady_timer>(ioc, op->deadline);
+    timer->async_wait([op](beast::error_code ec) {
+        if (!ec)
+            op->resolver.cancel();
+    });
+
+    op->resolver.async_resolve(host, port,
+        [this, op, timer](beast::error_code ec, tcp::resolver::results_type results) {
+            timer->cancel();
+            if (ec) {
+                Fail(op, ec == net::error::operation_aborted ? beast::error::timeout : ec);
+                return;
+            }
+            resolve_count++;
+            endpoints = results;
+            DoConnect(op);
+        });
+}
+
+void HTTPConnectionPool :: DoConnect(OperationPtr op) {
+
+    op->conn.reset(new Connection(ioc));
+    op->conn->stream.expires_at(op->deadline);
+    op->conn->stream.async_connect(endpoints,
+        [this, op](beast::error_code ec, tcp::endpoint) {
+            if (ec) {
+                endpoints = tcp::resolver::results_type();
+                Fail(op, ec);
+                return;
+            }
+            connect_count++;
+            Send(op);
+        });
+}
+
+void HTTPConnectionPool :: Send(OperationPtr op) {
+
+    op->conn->stream.expires_at(op->deadline);
+    http::async_write(op->conn->stream, op->exchange->req,
+        [this, op](beast::error_code ec, std::size_t) {
+            if (ec) {
+                Fail(op, ec);
+                return;
+            }
+            op->exchange->res = {};
+            http::async_read(op->conn->stream, op->conn->buffer, op->exchange->res,
+                [this, op](beast::error_code ec, std::size_t) {
+                    if (ec) {
+                        Fail(op, ec);
+                        return;
+                    }
+                    if (op->reused)
+                        reuse_count++;
+                    Release(std::move(op->conn), op->exchange->res.keep_alive());
+                    op->handler(ec);
+                });
+        });
+}
+
+void HTTPConnectionPool :: Fail(OperationPtr op, beast::error_code ec) {
+
+    op->conn.reset();
+
+    // The device may have timed out the idle connection, in which case the other
+    // idle ones are stale too. Retry once on a new one, anything else is a real failure.
+    if (op->reused && !op->retried && ec != beast::error::timeout) {
+        op->retried = true;
+        CloseIdle();
+        Connect(op);
+        return;
+    }
+    op->handler(ec);
+}
+
+void HTTPConnectionPool :: Release(std::unique_ptr<Connection> conn, bool keep_alive) {
+
+    if (keep_alive && idle.size() < max_idle) {
+        // No deadline while the connection sits idle.
+        conn->stream.expires_never();
+        idle.push_back(std::move(conn));
+        return;
+    }
+
+    beast::error_code ec;
+    conn->stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+}
+
+void HTTPConnectionPool :: CloseIdle(void) {
+
+    for (auto& conn : idle) {
+        beast::error_code ec;
+        conn->stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    }
+    idle.clear();
+}
+
+void HTTPConnectionPool :: Reset(void) {
+    CloseIdle();
+    endpoints = tcp::resolver::results_type();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+// A request and the response read for it. Shared between the caller and the
+// asynchronous operation, so it outlives both.
+struct HTTPExchange {
+    boost::beast::http::request<boost::beast::http::string_body> req;
+    boost::beast::http::response<boost::beast::http::string_body> res;
+};
+
+// Keeps HTTP/1.1 keep-alive connections to one device open between requests.
+// The resolved endpoint is cached, so in steady state a request costs neither a
+// DNS lookup nor a TCP handshake. A connection the device has dropped while idle
+// is replaced transparently by a fresh one.
+//
+// All operations are asynchronous and run on the io_context passed in. Each request
+// has a deadline covering resolve, connect, write and read, so a slow or unreachable
+// device never holds up anything else on the io_context.
+class HTTPConnectionPool {
+
+    public:
+    typedef std::function<void(boost::beast::error_code)> Handler;
+
+    private:
+    struct Connection {
+        boost::beast::tcp_stream stream;
+        boost::beast::flat_buffer buffer;     // Read buffer, must persist with the stream
+
+        explicit Connection(boost::asio::io_context& ioc) : stream(ioc) {}
+    };
+
+    // State of one request while it is in flight.
+    struct Operation {
+        std::shared_ptr<HTTPExchange> exchange;
+        Handler handler;
+        std::unique_ptr<Connection> conn;
+        boost::asio::ip::tcp::resolver resolver;
+        std::chrono::steady_clock::time_point deadline;
+        bool reused;
+        bool retried;
+
+        explicit Operation(boost::asio::io_context& ioc) : resolver(ioc), reused(false), retried(false) {}
+    };
+    typedef std::shared_ptr<Operation> OperationPtr;
+
+    boost::asio::io_context& ioc;
+    std::string host;
+    std::string port;
+
+    boost::asio::ip::tcp::resolver::results_type endpoints;   // Cached result of the last lookup
+    std::vector<std::unique_ptr<Connection>> idle;             // Open connections ready for reuse
+    std::size_t max_idle;                                      // Upper bound on idle connections kept open
+
+    unsigned long long resolve_count;     // Number of DNS lookups
+    unsigned long long connect_count;     // Number of TCP connections opened
+    unsigned long long reuse_count;       // Number of requests sent on an already open connection
+
+    // Steps of a request : take an idle connection or resolve / connect a new one,
+    // then write the request and read the response.
+    void Connect(OperationPtr op);
+    void DoConnect(OperationPtr op);
+    void Send(OperationPtr op);
+    void Fail(OperationPtr op, boost::beast::error_code ec);
+
+    // Keep the connection for the next request if the device allows it.
+    void Release(std::unique_ptr<Connection> conn, bool keep_alive);
+
+    // Close all idle connections.
+    void CloseIdle(void);
+
+    public:
+
+    HTTPConnectionPool(boost::asio::io_context& ioc, const std::string& host, const std::string& port,
+                       std::size_t max_idle = 4);
+
+    // Send the request and read the response, then call the handler with the result.
+    // A failure on a reused connection is retried once on a new connection, since the
+    // device may have closed it while idle. Fails with beast::error::timeout once
+    // 'timeout' has passed.
+    void AsyncRequest(std::shared_ptr<HTTPExchange> exchange, std::chrono::steady_clock::duration timeout,
+                      Handler handler);
+
+    // Close all idle connections and forget the resolved endpoint.
+    void Reset(void);
+
+    unsigned long long GetResolveCount(void) const { return resolve_count; }
+    unsigned long long GetConnectCount(void) const { return connect_count; }
+    unsigned long long GetReuseCount(void) const { return reuse_count; }
+};
@@ -0,0 +1,240 @@
+#include "json_reader.h"
+
+#include <algorithm>
+
+namespace {
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void SkipSpace(boost::string_view& in) {
+    while (!in.empty() && IsSpace(in.front()))
+        in.remove_prefix(1);
+}
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Read the four hex digits of a \u escape.
+bool ReadHex4(boost::string_view& in, unsigned& code) {
+
+    if (in.size() < 4)
+        return false;
+    code = 0;
+    for (int i = 0; i < 4; i++) {
+        int d = HexDigit(in[i]);
+        if (d < 0)
+            return false;
+        code = (code << 4) | static_cast<unsigned>(d);
+    }
+    in.remove_prefix(4);
+    return true;
+}
+
+void AppendUTF8(unsigned code, std::string& out) {
+
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xc0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xe0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    } else {
+        out += static_cast<char>(0xf0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+        out += static_cast<char>(0x80 | (code & 0x3f));
+    }
+}
+
+}
+
+JSONObjectReader :: JSONObjectReader(boost::string_view text) :
+                    in(text), started(false), done(false), failed(false) {
+
+}
+
+bool JSONObjectReader :: Fail(void) {
+    failed = true;
+    done = true;
+    return false;
+}
+
+bool JSONObjectReader :: Next(Member& member) {
+
+    if (done)
+        return false;
+
+    SkipSpace(in);
+    if (!started) {
+        if (in.empty() || in.front() != '{')
+            return Fail();
+        in.remove_prefix(1);
+        SkipSpace(in);
+        started = true;
+        if (!in.empty() && in.front() == '}') {
+            in.remove_prefix(1);
+            done = true;
+            return false;
+        }
+    } else {
+        if (in.empty())
+            return Fail();
+        if (in.front() == '}') {
+            in.remove_prefix(1);
+            done = true;
+            return false;
+        }
+        if (in.front() != ',')
+            return Fail();
+        in.remove_prefix(1);
+        SkipSpace(in);
+    }
+
+    if (!ReadString(member.key, member.key_escaped))
+        return Fail();
+
+    SkipSpace(in);
+    if (in.empty() || in.front() != ':')
+        return Fail();
+    in.remove_prefix(1);
+    SkipSpace(in);
+
+    if (!ReadValue(member))
+        return Fail();
+
+    return true;
+}
+
+bool JSONObjectReader :: ReadString(boost::string_view& out, bool& escaped) {
+
+    if (in.empty() || in.front() != '"')
+        return false;
+
+    escaped = false;
+    for (std::size_t i = 1; i < in.size(); i++) {
+        char c = in[i];
+        if (c == '"') {
+            out = in.substr(1, i - 1);
+            in.remove_prefix(i + 1);
+            return true;
+        }
+        if (c == '\\') {
+            escaped = true;
+            i++;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool JSONObjectReader :: ReadValue(Member& member) {
+
+    member.value_escaped = false;
+    if (in.empty())
+        return false;
+
+    char c = in.front();
+    if (c == '"') {
+        member.kind = STRING;
+        return ReadString(member.value, member.value_escaped);
+    }
+
+    if (c == '{' || c == '[') {
+        // Only the extent of a nested value is needed, so count brackets and step over
+        // strings, which may contain brackets of their own.
+        member.kind = NESTED;
+        boost::string_view start = in;
+        unsigned depth = 0;
+        while (!in.empty()) {
+            c = in.front();
+            if (c == '"') {
+                boost::string_view s;
+                bool escaped;
+                if (!ReadString(s, escaped))
+                    return false;
+                continue;
+            }
+            in.remove_prefix(1);
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    member.value = start.substr(0, start.size() - in.size());
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // A number or a literal runs up to the next separator.
+    member.kind = LITERAL;
+    std::size_t end = 0;
+    while (end < in.size() && in[end] != ',' && in[end] != '}' && !IsSpace(in[end]))
+        end++;
+    if (end == 0)
+        return false;
+    member.value = in.substr(0, end);
+    in.remove_prefix(end);
+    return true;
+}
+
+bool JSONObjectReader :: Unescape(boost::string_view raw, std::string& out) {
+
+    out.clear();
+    while (!raw.empty()) {
+        std::size_t pos = raw.find('\\');
+        out.append(raw.data(), std::min(pos, raw.size()));
+        if (pos == boost::string_view::npos)
+            break;
+        raw.remove_prefix(pos + 1);
+        if (raw.empty())
+            return false;
+
+        char c = raw.front();
+        raw.remove_prefix(1);
+        switch (c) {
+            case '"':  out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/'; break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u': {
+                unsigned code;
+                if (!ReadHex4(raw, code))
+                    return false;
+                // A character outside the basic plane is written as a surrogate pair.
+                if (code >= 0xd800 && code < 0xdc00) {
+                    unsigned low;
+                    if (raw.size() < 2 || raw[0] != '\\' || raw[1] != 'u')
+                        return false;
+                    raw.remove_prefix(2);
+                    if (!ReadHex4(raw, low) || low < 0xdc00 || low >= 0xe000)
+                        return false;
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                AppendUTF8(code, out);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
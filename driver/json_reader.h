@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+
+#include <boost/utility/string_view.hpp>
+
+// Reads the members of a flat JSON object, such as the device responses
+//
+//      {"Alert":"INFO","Status":"Enabled","Temperature":"40"}
+//
+// in place from the response text, one member at a time. Keys and values are handed out
+// as views into the text, so nothing is copied or allocated unless a string contains an
+// escape sequence and the caller asks for it to be decoded.
+class JSONObjectReader {
+
+    public:
+    enum ValueKind {
+        STRING,      // A string, 'value' is the text between the quotes
+        LITERAL,     // A number, true, false or null, 'value' is the literal as written
+        NESTED       // An object or an array, 'value' is its whole text
+    };
+
+    // One member of the object. 'key' and a STRING 'value' still hold any escape
+    // sequences, the flags say whether there are any.
+    struct Member {
+        boost::string_view key;
+        boost::string_view value;
+        ValueKind kind;
+        bool key_escaped;
+        bool value_escaped;
+    };
+
+    // 'text' must outlive the reader and the members it returns.
+    explicit JSONObjectReader(boost::string_view text);
+
+    // Read the next member. Returns false at the end of the object, or if the text is
+    // not a JSON object, in which case Failed() is true.
+    bool Next(Member& member);
+
+    bool Failed(void) const { return failed; }
+
+    // Decode the escape sequences of a string as returned in a Member into 'out'.
+    // Returns false for an invalid escape sequence.
+    static bool Unescape(boost::string_view raw, std::string& out);
+
+    private:
+    boost::string_view in;   // Text not read yet
+    bool started;            // The opening brace has been read
+    bool done;               // The closing brace has been read, or the text is invalid
+    bool failed;             // The text is not a JSON object
+
+    bool Fail(void);
+
+    // Read a string at the start of 'in', leaving the text between the quotes in 'out'.
+    bool ReadString(boost::string_view& out, bool& escaped);
+
+    // Read a value of any kind into the value and kind of 'member'.
+    bool ReadValue(Member& member);
+};
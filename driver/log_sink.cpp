@@ -0,0 +1,124 @@
+#include "log_sink.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
+#include <boost/log/sinks/text_file_backend.hpp>
+#include <boost/log/sources/severity_logger.hpp>
+#include <boost/log/utility/setup/common_attributes.hpp>
+#include <boost/log/utility/setup/formatter_parser.hpp>
+
+namespace logging = boost::log;
+namespace sinks = boost::log::sinks;
+namespace keywords = boost::log::keywords;
+namespace src = boost::log::sources;
+
+namespace {
+
+std::atomic<unsigned long long> dropped(0);
+
+// Like sinks::drop_on_overflow, but counts the records it drops.
+class CountingDropOnOverflow {
+    public:
+    template <typename LockT>
+    static bool on_overflow(logging::record_view const&, LockT&) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    static void on_queue_space_available() {}
+    static void interrupt() {}
+};
+
+// Records queued for the file. Enough for a full parameter dump of many devices, small
+// enough that a stalled disk does not grow the driver without bound.
+const std::size_t QUEUE_SIZE = 8192;
+
+typedef sinks::asynchronous_sink<sinks::text_file_backend,
+                                 sinks::bounded_fifo_queue<QUEUE_SIZE, CountingDropOnOverflow>> file_sink;
+
+boost::shared_ptr<file_sink> sink;
+
+// Flushes the file now and then, from a thread of its own as a flush waits for the disk.
+std::thread flusher;
+std::mutex flusher_mutex;
+std::condition_variable flusher_wakeup;
+bool flusher_stop = false;
+
+void RunFlusher(std::chrono::milliseconds flush_interval) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    unsigned long long reported = 0;
+    std::unique_lock<std::mutex> lock(flusher_mutex);
+    while (!flusher_stop) {
+        flusher_wakeup.wait_for(lock, flush_interval);
+
+        unsigned long long count = dropped.load(std::memory_order_relaxed);
+        if (count != reported) {
+            BOOST_LOG_SEV(lg, warning) << "Log queue full, dropped [" << count - reported << "] records";
+            reported = count;
+        }
+
+        lock.unlock();
+        sink->flush();
+        lock.lock();
+    }
+}
+
+}
+
+void LogSink :: Start(const std::string& file_pattern, logging::trivial::severity_level min_level,
+                      std::chrono::milliseconds flush_interval) {
+
+    boost::shared_ptr<sinks::text_file_backend> backend = boost::make_shared<sinks::text_file_backend>
+    (
+        keywords::file_name = file_pattern,                                           /*< file name pattern >*/
+        keywords::rotation_size = 10 * 1024 * 1024,                                   /*< rotate files every 10 MiB... >*/
+        keywords::time_based_rotation = sinks::file::rotation_at_time_point(0, 0, 0), /*< ...or at midnight >*/
+        keywords::auto_flush = false                                                  /*< flushed by the flusher thread >*/
+    );
+
+    sink = boost::make_shared<file_sink>(backend);
+    sink->set_formatter(logging::parse_formatter("[%TimeStamp%]: %Message%"));
+    logging::core::get()->add_sink(sink);
+
+    logging::core::get()->set_filter
+    (
+        logging::trivial::severity >= min_level
+    );
+
+    logging::add_common_attributes();
+
+    flusher = std::thread(RunFlusher, flush_interval);
+}
+
+void LogSink :: Stop(void) {
+
+    if (!sink)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(flusher_mutex);
+        flusher_stop = true;
+    }
+    flusher_wakeup.notify_one();
+    flusher.join();
+
+    logging::core::get()->remove_sink(sink);
+    sink->stop();
+    sink->flush();
+    sink.reset();
+}
+
+unsigned long long LogSink :: GetDroppedCount(void) {
+    return dropped.load(std::memory_order_relaxed);
+}
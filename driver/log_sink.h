@@ -0,0 +1,30 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include <boost/log/trivial.hpp>
+
+// Writes the driver's log records to a file from a background thread, so that neither
+// formatting the file output nor disk latency holds up the io_context. Records wait in
+// a bounded queue; when the queue is full a record is dropped and counted rather than
+// blocking the thread logging it. The file is flushed every flush_interval and when the
+// sink stops, not after every record.
+//
+// Records below min_level are filtered out before they are formatted, so
+//      BOOST_LOG_SEV(lg, debug) << "Value [" << value << "]";
+// costs next to nothing unless debug logging is on.
+class LogSink {
+
+    public:
+
+    // Start logging to files named after 'file_pattern', e.g. "/tmp/radio_%N.log".
+    static void Start(const std::string& file_pattern, boost::log::trivial::severity_level min_level,
+                      std::chrono::milliseconds flush_interval);
+
+    // Write out the queued records and stop the background threads.
+    static void Stop(void);
+
+    // Number of records dropped because the queue was full.
+    static unsigned long long GetDroppedCount(void);
+};
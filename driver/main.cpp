@@ -0,0 +1,164 @@
+#include "driver.h"
+
+#ifdef DRIVER_DEVICE_PROFILES
+#include "isode_radio_profile.h"
+#endif
+
+namespace logging = boost::log;
+
+// Read a device list file. Each line names a device, optionally followed by the host and
+// port of the device if they differ from --host / --port. Empty lines and lines starting
+// with '#' are ignored.
+//
+//      radio1
+//      radio2 10.0.0.5 8082
+static bool ReadDeviceList (const std::string& file_name, const std::string& default_host,
+                            const std::string& default_port, DriverHost& host) {
+
+    std::ifstream in(file_name);
+    if (!in)
+        return false;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name, device_host(default_host), device_port(default_port);
+        if (!(fields >> name) || name[0] == '#')
+            continue;
+        fields >> device_host >> device_port;
+        host.AddDevice(device_host, device_port, name);
+    }
+    return true;
+}
+
+int main (int argc, char * argv[]) {
+
+    boost::program_options::options_description desc
+        ("\nMandatory arguments marked with '*'.\n"
+           "Invocation : <driver_executable> --host <hostname> --port <port> --device_name <device_name> --schema_file <filename> --std_params_file <filename>\n"
+           "Several devices can be managed by one driver by repeating --device_name or with --device_list.\nArguments");
+
+    desc.add_options ()
+    ("host", boost::program_options::value<std::string>()->required(),
+                 "* Hostname.")
+    ("port",  boost::program_options::value<std::string>()->required(),
+                 "* Port")
+    ("device_name",  boost::program_options::value<std::vector<std::string>>()->composing(),
+                 "* Device Name (may be repeated)")
+    ("device_list",  boost::program_options::value<std::string>(),
+                 "File listing one device per line : <device_name> [<host> <port>]")
+    ("schema_file",  boost::program_options::value<std::string>()->required(),
+                 "* Schema File")
+    ("std_params_file",  boost::program_options::value<std::string>()->required(),
+                 "* Standard Params File")
+    ("max_batch_delay",  boost::program_options::value<unsigned int>()->default_value(50),
+                 "Milliseconds a monitor tick may hold its status messages back to write them to RB "
+                 "in one go. With 0 the messages of each update are still written together.")
+    ("deadband",  boost::program_options::value<double>()->default_value(0),
+                 "Percent of the range between LowerBound and UpperBound an Integer param must move "
+                 "before the change is sent to RB. With 0 every change is sent.")
+    ("poll_interval",  boost::program_options::value<unsigned int>()->default_value(5000),
+                 "Milliseconds between checks for device params due to be polled.")
+    ("heartbeat_interval",  boost::program_options::value<unsigned int>()->default_value(5000),
+                 "Milliseconds between heartbeats sent to RB.")
+    ("status_poll_interval",  boost::program_options::value<unsigned int>()->default_value(5000),
+                 "Milliseconds between polls of the device status params, e.g. SignalLevel.")
+    ("ref_poll_interval",  boost::program_options::value<unsigned int>()->default_value(30000),
+                 "Milliseconds between polls of the referenced status params, e.g. Version.")
+    ("full_poll_interval",  boost::program_options::value<unsigned int>()->default_value(60000),
+                 "Milliseconds between polls of all device params, including the control params.")
+    ("max_poll_backoff",  boost::program_options::value<unsigned int>()->default_value(4),
+                 "While its params do not change, the poll interval of a group doubles up to this "
+                 "many times its configured value. With 1 the intervals stay fixed.")
+    ("device_events",  boost::program_options::value<bool>()->default_value(true),
+                 "Follow the changes a device pushes as server-sent events on /device/<name>/events, "
+                 "if it does. While they flow, the device is only polled every --sweep_interval.")
+    ("sweep_interval",  boost::program_options::value<unsigned int>()->default_value(60000),
+                 "Milliseconds between polls of all device params while the device pushes its changes, "
+                 "to catch anything an event missed.")
+    ("schema_cache",  boost::program_options::value<std::string>()->default_value(""),
+                 "Directory keeping a compiled image of the schema, so that later starts with the same "
+                 "schema files skip parsing the XML. It should belong to the user running the driver, an "
+                 "image that does not, or that others can write, is ignored. Empty, the default, to always "
+                 "parse it.")
+    ("stats_interval",  boost::program_options::value<unsigned int>()->default_value(60),
+                 "Seconds between summaries of the driver's performance statistics in the log, 0 for "
+                 "none. SIGUSR1 dumps them in full.")
+    ("log_level",  boost::program_options::value<std::string>()->default_value("info"),
+                 "Lowest severity logged : trace, debug, info, warning, error or fatal. Every message "
+                 "to and from the device and RB is logged at debug.");
+
+    boost::program_options::variables_map vm;
+
+    try {
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).run(), vm);
+        boost::program_options::notify(vm);
+    } catch (boost::program_options::error& e) {
+        std::cout << "ERROR: " << e.what() << "\n";
+        std::cout << desc << "\n";
+        return 1;
+    }
+
+    if (!vm.count("device_name") && !vm.count("device_list")) {
+        std::cout << "Error !! Check usage below.\n";
+        std::cout << desc << "\n";
+        exit(0);
+    }
+
+    // Parse the isode-radio.xml device configuration file and store
+    // the device status and device control params.
+    std :: string host(vm["host"].as<std::string>());
+    std :: string port(vm["port"].as<std::string>());
+    std :: string schemafile(vm["schema_file"].as<std::string>());
+    std :: string stdparamsfile(vm["std_params_file"].as<std::string>());
+
+    DriverHost driverhost(schemafile, stdparamsfile,
+                          std::chrono::milliseconds(vm["max_batch_delay"].as<unsigned int>()));
+
+    driverhost.SetDeadband(vm["deadband"].as<double>());
+
+    if (vm["poll_interval"].as<unsigned int>() == 0 || vm["heartbeat_interval"].as<unsigned int>() == 0) {
+        std::cout << "ERROR: --poll_interval and --heartbeat_interval must be at least 1 millisecond\n";
+        return 1;
+    }
+
+    PollIntervals poll_intervals;
+    poll_intervals.tick = std::chrono::milliseconds(vm["poll_interval"].as<unsigned int>());
+    poll_intervals.status = std::chrono::milliseconds(vm["status_poll_interval"].as<unsigned int>());
+    poll_intervals.ref = std::chrono::milliseconds(vm["ref_poll_interval"].as<unsigned int>());
+    poll_intervals.full = std::chrono::milliseconds(vm["full_poll_interval"].as<unsigned int>());
+    poll_intervals.max_backoff = vm["max_poll_backoff"].as<unsigned int>();
+    driverhost.SetPollIntervals(poll_intervals);
+    driverhost.SetHeartBeatInterval(std::chrono::milliseconds(vm["heartbeat_interval"].as<unsigned int>()));
+    driverhost.SetDeviceEvents(vm["device_events"].as<bool>(),
+                               std::chrono::milliseconds(vm["sweep_interval"].as<unsigned int>()));
+
+    logging::trivial::severity_level log_level;
+    if (!logging::trivial::from_string(vm["log_level"].as<std::string>().c_str(),
+                                       vm["log_level"].as<std::string>().size(), log_level)) {
+        std::cout << "ERROR: Unknown --log_level [" << vm["log_level"].as<std::string>() << "]\n";
+        return 1;
+    }
+    driverhost.SetLogLevel(log_level);
+    driverhost.SetSchemaCache(vm["schema_cache"].as<std::string>());
+#ifdef DRIVER_DEVICE_PROFILES
+    driverhost.AddCompiledSchema(CompiledSchemaOf<IsodeRadioProfile>());
+#endif
+    driverhost.SetStatsInterval(std::chrono::seconds(vm["stats_interval"].as<unsigned int>()));
+
+    if (vm.count("device_name")) {
+        for (const auto& name : vm["device_name"].as<std::vector<std::string>>())
+            driverhost.AddDevice(host, port, name);
+    }
+
+    if (vm.count("device_list")) {
+        std :: string listfile(vm["device_list"].as<std::string>());
+        if (!ReadDeviceList(listfile, host, port, driverhost)) {
+            std::cout << "ERROR: Can't read device list [" << listfile << "]\n";
+            return 1;
+        }
+    }
+
+    driverhost.Start();
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include "msg_template.h"
+
+MessageTemplate :: MessageTemplate() {
+
+}
+
+MessageTemplate :: MessageTemplate(const std::string& format, std::initializer_list<std::string> placeholders) {
+    Parse(format, placeholders);
+}
+
+void MessageTemplate :: Parse(const std::string& format, std::initializer_list<std::string> placeholders) {
+
+    literals.clear();
+    segments.clear();
+
+    std::size_t literal_start = 0;
+    std::size_t pos = 0;
+
+    while (pos < format.size()) {
+        // Check if one of the placeholders starts at this position.
+        int index = 0;
+        int found = -1;
+        for (const auto& p : placeholders) {
+            if (!p.empty() && format.compare(pos, p.size(), p) == 0) {
+                found = index;
+                break;
+            }
+            index++;
+        }
+
+        if (found < 0) {
+            pos++;
+            continue;
+        }
+
+        // Flush the literal text preceding the placeholder.
+        if (pos > literal_start) {
+            segments.push_back(Segment{literals.size(), pos - literal_start, -1});
+            literals.append(format, literal_start, pos - literal_start);
+        }
+        segments.push_back(Segment{0, 0, found});
+
+        pos += (placeholders.begin() + found)->size();
+        literal_start = pos;
+    }
+
+    if (format.size() > literal_start) {
+        segments.push_back(Segment{literals.size(), format.size() - literal_start, -1});
+        literals.append(format, literal_start, std::string::npos);
+    }
+}
+
+void MessageTemplate :: Render(std::string& out, std::initializer_list<boost::string_view> values) const {
+
+    std::size_t size = literals.size();
+    for (const auto& seg : segments) {
+        if (seg.placeholder >= 0 && static_cast<std::size_t>(seg.placeholder) < values.size())
+            size += (values.begin() + seg.placeholder)->size();
+    }
+
+    // clear() keeps the capacity, so a buffer reused across calls stops allocating
+    // once it has grown to the largest message.
+    out.clear();
+    out.reserve(size);
+
+    for (const auto& seg : segments) {
+        if (seg.placeholder < 0) {
+            out.append(literals, seg.offset, seg.length);
+        } else if (static_cast<std::size_t>(seg.placeholder) < values.size()) {
+            const boost::string_view& v = *(values.begin() + seg.placeholder);
+            out.append(v.data(), v.size());
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+#include <boost/utility/string_view.hpp>
+
+// A message template is parsed once into literal and placeholder segments.
+// Rendering then appends the literals and the supplied placeholder values
+// into a reusable buffer in a single pass, without any regex work.
+//
+// Example :
+//      MessageTemplate t("<Param>_paramname_</Param>", {"_paramname_"});
+//      t.Render(buffer, {"Frequency"});    // buffer = "<Param>Frequency</Param>"
+class MessageTemplate {
+
+    private:
+    struct Segment {
+        std::size_t offset;        // Offset of the literal in 'literals'
+        std::size_t length;        // Length of the literal
+        int placeholder;           // Index of the placeholder or -1 for a literal
+    };
+
+    std::string literals;              // All literal text of the template, back to back
+    std::vector<Segment> segments;     // Literal and placeholder segments in output order
+
+    public:
+
+    MessageTemplate();
+    MessageTemplate(const std::string& format, std::initializer_list<std::string> placeholders);
+
+    // Split the format into segments. A placeholder may occur any number of times,
+    // its index is its position in 'placeholders'.
+    void Parse(const std::string& format, std::initializer_list<std::string> placeholders);
+
+    // Render the template into 'out' (which is cleared first). values[i] is
+    // substituted for placeholder i, missing values render as empty.
+    void Render(std::string& out, std::initializer_list<boost::string_view> values) const;
+};
@@ -0,0 +1,128 @@
+#include "param_registry.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+static const std::string type_names[] = {"", "Integer", "String", "Boolean", "DateTime", "Enumerated", "AlertType"};
+
+const std::string& ParamTypeName(ParamType type) {
+    return type_names[static_cast<std::size_t>(type)];
+}
+
+ParamType ParseParamType(boost::string_view name) {
+    for (std::size_t i = 1; i < sizeof(type_names) / sizeof(type_names[0]); i++) {
+        if (name == type_names[i])
+            return static_cast<ParamType>(i);
+    }
+    return ParamType::None;
+}
+
+ParamRegistry :: ParamRegistry() : seed(0) {
+
+}
+
+// FNV-1a over the name, started from the seed, with a final mix so that the low bits
+// used to pick a slot depend on every byte.
+std::uint64_t ParamRegistry :: Hash(boost::string_view name, std::uint64_t seed) {
+
+    std::uint64_t h = 0xcbf29ce484222325ULL ^ (seed * 0x9e3779b97f4a7c15ULL);
+    for (char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+ParamId ParamRegistry :: Add(const std::string& name) {
+
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it != names.end())
+        return static_cast<ParamId>(it - names.begin());
+
+    if (names.size() >= NO_PARAM)
+        throw std::length_error("Too many device params");
+
+    names.push_back(name);
+    types.push_back(ParamType::None);
+    bounds.push_back(ParamBounds());
+    enum_values.emplace_back();
+    slots.clear();
+    return static_cast<ParamId>(names.size() - 1);
+}
+
+void ParamRegistry :: SetType(ParamId id, ParamType type) {
+    if (types[id] == ParamType::None)
+        types[id] = type;
+}
+
+void ParamRegistry :: SetBounds(ParamId id, const ParamBounds& range) {
+    if (!bounds[id].bounded)
+        bounds[id] = range;
+}
+
+void ParamRegistry :: SetEnumValues(ParamId id, std::vector<std::string> values) {
+    if (enum_values[id].empty())
+        enum_values[id] = std::move(values);
+}
+
+int ParamRegistry :: FindEnumValue(ParamId id, boost::string_view value) const {
+    const std::vector<std::string>& values = enum_values[id];
+    for (std::size_t i = 0; i < values.size(); i++) {
+        if (values[i] == value)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void ParamRegistry :: Build(void) {
+
+    // Try seeds until every name lands in a slot of its own, growing the table if no
+    // seed is found quickly. With the table at least twice the number of names this
+    // takes a handful of tries.
+    std::size_t size = 8;
+    while (size < names.size() * 2)
+        size *= 2;
+
+    while (true) {
+        for (std::uint64_t s = 1; s <= 1000; s++) {
+            slots.assign(size, NO_PARAM);
+            bool collision = false;
+            for (std::size_t id = 0; id < names.size() && !collision; id++) {
+                ParamId& slot = slots[Hash(names[id], s) & (size - 1)];
+                if (slot != NO_PARAM)
+                    collision = true;
+                else
+                    slot = static_cast<ParamId>(id);
+            }
+            if (!collision) {
+                seed = s;
+                return;
+            }
+        }
+        size *= 2;
+    }
+}
+
+void ParamRegistry :: Restore(std::vector<std::string> arg_names, std::vector<ParamType> arg_types,
+                              std::vector<ParamBounds> arg_bounds, std::vector<ParamId> arg_slots, std::uint64_t arg_seed) {
+    names = std::move(arg_names);
+    types = std::move(arg_types);
+    bounds = std::move(arg_bounds);
+    enum_values.assign(names.size(), std::vector<std::string>());
+    slots = std::move(arg_slots);
+    seed = arg_seed;
+}
+
+ParamId ParamRegistry :: Find(boost::string_view name) const {
+
+    if (slots.empty())
+        return NO_PARAM;
+
+    ParamId id = slots[Hash(name, seed) & (slots.size() - 1)];
+    if (id == NO_PARAM || names[id] != name)
+        return NO_PARAM;
+    return id;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/utility/string_view.hpp>
+
+// Types a param value can have in the device schema and the standard parameters.
+enum class ParamType : std::uint8_t {
+    None,          // No type given, e.g. a referenced status param without a standard definition
+    Integer,
+    String,
+    Boolean,
+    DateTime,
+    Enumerated,
+    AlertType
+};
+
+// Dense index of a param in a ParamRegistry.
+typedef std::uint16_t ParamId;
+static const ParamId NO_PARAM = 0xffff;
+
+// Return the element name used for a type in status messages, "" for ParamType::None.
+const std::string& ParamTypeName(ParamType type);
+
+// Return the type named by a schema element, ParamType::None if it does not name one.
+ParamType ParseParamType(boost::string_view name);
+
+// The range of an Integer param as given in the schema.
+struct ParamBounds {
+    bool bounded;            // Both LowerBound and UpperBound were given
+    long long lower;
+    long long upper;
+    long long multiplier;    // The value shown to operators is the param value divided by this
+
+    ParamBounds() : bounded(false), lower(0), upper(0), multiplier(1) {}
+};
+
+// Assigns every param of a device type a dense ID, so that per-param state can be kept
+// in flat arrays indexed by ID rather than in maps keyed by name. Names are mapped to
+// IDs through a perfect hash table built once all params have been added, so a lookup
+// costs one hash and one string compare.
+//
+// Example :
+//      ParamRegistry r;
+//      ParamId id = r.Add("Frequency");
+//      r.SetType(id, ParamType::Integer);
+//      r.Build();
+//      r.Find("Frequency");    // id
+class ParamRegistry {
+
+    private:
+    std::vector<std::string> names;     // Indexed by ID
+    std::vector<ParamType> types;       // Indexed by ID
+    std::vector<ParamBounds> bounds;    // Indexed by ID
+    std::vector<std::vector<std::string>> enum_values;   // Indexed by ID, values of an Enumerated param
+
+    std::vector<ParamId> slots;         // Perfect hash table of IDs, NO_PARAM for free slots
+    std::uint64_t seed;                 // Seed that makes the hash collision free for 'names'
+
+    static std::uint64_t Hash(boost::string_view name, std::uint64_t seed);
+
+    public:
+
+    ParamRegistry();
+
+    // Return the ID of a param, adding it if it is not known yet. Invalidates the hash
+    // table until Build() is called again.
+    ParamId Add(const std::string& name);
+
+    // Set the type of a param unless it already has one.
+    void SetType(ParamId id, ParamType type);
+
+    // Set the range of a param unless it already has one.
+    void SetBounds(ParamId id, const ParamBounds& range);
+
+    // Set the values of an Enumerated param unless it already has some.
+    void SetEnumValues(ParamId id, std::vector<std::string> values);
+
+    // Build the hash table used by Find().
+    void Build(void);
+
+    // Take over the params and the hash table of a registry saved earlier, e.g. by the
+    // schema cache, without building the table again. Enum values are set afterwards.
+    void Restore(std::vector<std::string> names, std::vector<ParamType> types, std::vector<ParamBounds> bounds,
+                 std::vector<ParamId> slots, std::uint64_t seed);
+
+    // Return the ID of a param, or NO_PARAM if it is not known.
+    ParamId Find(boost::string_view name) const;
+
+    std::size_t Size(void) const { return names.size(); }
+    const std::string& Name(ParamId id) const { return names[id]; }
+    ParamType Type(ParamId id) const { return types[id]; }
+    const std::string& TypeName(ParamId id) const { return ParamTypeName(types[id]); }
+    const ParamBounds& Bounds(ParamId id) const { return bounds[id]; }
+    const std::vector<std::string>& EnumValues(ParamId id) const { return enum_values[id]; }
+
+    // Return the ordinal of a value of an Enumerated param, or -1 if it is not one of its values.
+    int FindEnumValue(ParamId id, boost::string_view value) const;
+
+    // The hash table, to be saved along with the params.
+    const std::vector<ParamId>& Slots(void) const { return slots; }
+    std::uint64_t Seed(void) const { return seed; }
+};
+
+// A set of param IDs with one bit per param, so that going through the members costs
+// one word per 64 params plus one step per member, however many params there are.
+class ParamBitmap {
+
+    private:
+    std::vector<std::uint64_t> words;
+
+    static unsigned LowestBit(std::uint64_t bits) {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+        unsigned n = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            n++;
+        }
+        return n;
+#endif
+    }
+
+    public:
+
+    // Make room for 'param_count' params, with none in the set.
+    void Resize(std::size_t param_count) { words.assign((param_count + 63) / 64, 0); }
+
+    void Set(ParamId id) { words[id >> 6] |= std::uint64_t(1) << (id & 63); }
+    void Reset(ParamId id) { words[id >> 6] &= ~(std::uint64_t(1) << (id & 63)); }
+    bool Test(ParamId id) const { return (words[id >> 6] >> (id & 63)) & 1; }
+    void Clear(void) { std::fill(words.begin(), words.end(), 0); }
+
+    bool Any(void) const {
+        return std::any_of(words.begin(), words.end(), [](std::uint64_t w) { return w != 0; });
+    }
+
+    // Call f(id) for each member in ID order.
+    template <typename F>
+    void ForEach(F f) const {
+        for (std::size_t i = 0; i < words.size(); i++) {
+            for (std::uint64_t bits = words[i]; bits != 0; bits &= bits - 1)
+                f(static_cast<ParamId>(i * 64 + LowestBit(bits)));
+        }
+    }
+};
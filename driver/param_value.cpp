@@ -0,0 +1,118 @@
+#include "param_value.h"
+
+#include <cstdint>
+
+namespace {
+
+// Parse exactly 'digits' decimal digits at 'pos'.
+bool ParseDigits(boost::string_view text, std::size_t pos, std::size_t digits, int& value) {
+    if (pos + digits > text.size())
+        return false;
+    value = 0;
+    for (std::size_t i = pos; i < pos + digits; i++) {
+        if (text[i] < '0' || text[i] > '9')
+            return false;
+        value = value * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+// Days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+std::int64_t DaysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = static_cast<int>(year - era * 400);
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+}
+
+bool ParamValue :: ParseInteger(boost::string_view text, std::int64_t& value) {
+
+    if (text.empty())
+        return false;
+
+    bool negative = text.front() == '-';
+    if (negative)
+        text.remove_prefix(1);
+    if (text.empty())
+        return false;
+
+    // The magnitude is accumulated unsigned, so that -9223372036854775808 parses while
+    // 9223372036854775808 and anything longer is refused rather than overflowing.
+    const std::uint64_t limit = negative ? std::uint64_t(INT64_MAX) + 1 : std::uint64_t(INT64_MAX);
+    std::uint64_t magnitude = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9')
+            return false;
+        unsigned digit = c - '0';
+        if (magnitude > (limit - digit) / 10)
+            return false;
+        magnitude = magnitude * 10 + digit;
+    }
+    value = negative ? std::int64_t(0 - magnitude) : std::int64_t(magnitude);
+    return true;
+}
+
+bool ParamValue :: ParseDateTime(boost::string_view text, std::int64_t& seconds) {
+
+    if (ParseInteger(text, seconds))
+        return true;
+
+    // 2021-06-03 17:34:40, or with a 'T' between the date and the time.
+    int year, month, day, hour, minute, second;
+    if (text.size() != 19 || text[4] != '-' || text[7] != '-' || (text[10] != ' ' && text[10] != 'T') ||
+        text[13] != ':' || text[16] != ':' ||
+        !ParseDigits(text, 0, 4, year) || !ParseDigits(text, 5, 2, month) || !ParseDigits(text, 8, 2, day) ||
+        !ParseDigits(text, 11, 2, hour) || !ParseDigits(text, 14, 2, minute) || !ParseDigits(text, 17, 2, second))
+        return false;
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return false;
+
+    seconds = DaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+bool ParamValue :: Assign(const ParamRegistry& params, ParamId id, boost::string_view value) {
+
+    bool parsed = true;
+    std::int64_t parsed_native = 0;
+    switch (params.Type(id)) {
+        case ParamType::Integer:
+            parsed = ParseInteger(value, parsed_native);
+            break;
+        case ParamType::Boolean:
+            parsed = value == "true" || value == "false";
+            parsed_native = value == "true";
+            break;
+        case ParamType::DateTime:
+            parsed = ParseDateTime(value, parsed_native);
+            break;
+        case ParamType::Enumerated:
+            parsed_native = params.FindEnumValue(id, value);
+            parsed = parsed_native >= 0;
+            break;
+        default:
+            break;
+    }
+
+    // A string compares by its text, which is also how a value that does not parse
+    // compares with whatever was there before.
+    bool native_type = params.Type(id) != ParamType::String && params.Type(id) != ParamType::None &&
+                       params.Type(id) != ParamType::AlertType;
+    bool changed;
+    if (native_type && parsed && valid)
+        changed = parsed_native != native;
+    else if (native_type)
+        changed = parsed != valid || value != text;
+    else
+        changed = value != text;
+
+    if (value != text)
+        text.assign(value.data(), value.size());
+    valid = parsed;
+    native = parsed ? parsed_native : 0;
+    return changed;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <boost/utility/string_view.hpp>
+
+#include "param_registry.h"
+
+// The value of a param as the device reported it, along with its native value parsed
+// once when it is stored : Integer as a 64 bit integer, Boolean as 0 / 1, DateTime as
+// seconds since the epoch and Enumerated as the ordinal of the value in the schema.
+// Changes, bounds and deadbands are then worked out on the native value, while the
+// text is what is sent to RB.
+//
+// Example :
+//      ParamValue v;
+//      v.Assign(params, frequency_id, "12000");     // true, Integer() == 12000
+//      v.Assign(params, frequency_id, "012000");    // false, the same number
+//      v.Scaled(params.Bounds(frequency_id));       // 12, Frequency has a multiplier of 1000
+class ParamValue {
+
+    private:
+    std::string text;        // As reported by the device
+    bool valid;              // 'text' parses as the type of the param
+    std::int64_t native;     // Native value if valid
+
+    public:
+
+    ParamValue() : valid(false), native(0) {}
+
+    // Store a new value of param 'id' of 'params'. Returns true if it differs from the
+    // value held, by native value if both parse and by text otherwise.
+    bool Assign(const ParamRegistry& params, ParamId id, boost::string_view value);
+
+    const std::string& Text(void) const { return text; }
+
+    // False for a value that does not parse as the type of the param, e.g. an Integer of
+    // "" or "n/a". Values of String, AlertType and untyped params are always valid.
+    bool Valid(void) const { return valid; }
+
+    std::int64_t Integer(void) const { return native; }
+    bool Boolean(void) const { return native != 0; }
+    std::chrono::system_clock::time_point Time(void) const {
+        return std::chrono::system_clock::time_point(std::chrono::seconds(native));
+    }
+    int Ordinal(void) const { return static_cast<int>(native); }
+
+    // The Integer value as shown to operators, i.e. divided by the multiplier of the param.
+    double Scaled(const ParamBounds& bounds) const {
+        return bounds.multiplier > 1 ? double(native) / bounds.multiplier : double(native);
+    }
+
+    // True for a valid Integer that is outside of the bounds of a bounded param.
+    bool OutOfRange(const ParamBounds& bounds) const {
+        return valid && bounds.bounded && (native < bounds.lower || native > bounds.upper);
+    }
+
+    // Parse a whole string as a decimal integer. A value beyond the range of int64_t, e.g.
+    // "9999999999999999999", does not parse.
+    static bool ParseInteger(boost::string_view text, std::int64_t& value);
+
+    // Parse a DateTime, either seconds since the epoch or "YYYY-MM-DD HH:MM:SS" in UTC
+    // as the device reports its StartTime.
+    static bool ParseDateTime(boost::string_view text, std::int64_t& seconds);
+};
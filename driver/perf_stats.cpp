@@ -0,0 +1,154 @@
+#include "perf_stats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+const char* const histogram_names[] = {
+    "HTTPGet", "HTTPPost", "GetParamDetails", "SendStatus", "SendCBOR", "HeartBeatDrift", "FramesPerTick"
+};
+
+const char* const counter_names[] = {
+    "MonitorTicks", "SkippedTicks", "HTTPErrors", "DeviceEvents", "NotModified"
+};
+
+unsigned HighestBit(uint64_t value) {
+#if defined(__GNUC__)
+    return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned n = 0;
+    while (value >>= 1)
+        n++;
+    return n;
+#endif
+}
+
+// Durations are shown in microseconds, counts as they are.
+void WriteValue(std::ostream& out, PerfHistogram h, uint64_t value) {
+    if (h == PerfHistogram::FramesPerTick)
+        out << value;
+    else
+        out << std::fixed << std::setprecision(1) << value / 1000.0 << "us";
+}
+
+}
+
+std::array<LatencyHistogram, static_cast<std::size_t>(PerfHistogram::Count)> PerfStats::histograms;
+std::array<std::atomic<uint64_t>, static_cast<std::size_t>(PerfCounter::Count)> PerfStats::counters{};
+
+LatencyHistogram :: LatencyHistogram() : count(0), sum(0), max(0) {
+    for (auto& bucket : buckets)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+unsigned LatencyHistogram :: BucketOf(uint64_t value) {
+
+    // Values below SUB_BUCKETS have a bucket each.
+    if (value < SUB_BUCKETS)
+        return static_cast<unsigned>(value);
+
+    // Otherwise the bits below the top SUB_BITS + 1 are dropped.
+    unsigned shift = HighestBit(value) - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + static_cast<unsigned>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t LatencyHistogram :: BucketLimit(unsigned bucket) {
+
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    unsigned shift = bucket / SUB_BUCKETS - 1;
+    uint64_t top = SUB_BUCKETS | (bucket % SUB_BUCKETS);
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram :: Record(uint64_t value) {
+
+    buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+        ;
+}
+
+uint64_t LatencyHistogram :: Percentile(double q) const {
+
+    uint64_t total = Count();
+    if (total == 0)
+        return 0;
+
+    // The rank of the value wanted, counting from 1.
+    uint64_t rank = static_cast<uint64_t>(q * total + 0.5);
+    if (rank < 1)
+        rank = 1;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(BucketLimit(i), Max());
+    }
+    return Max();
+}
+
+std::string PerfStats :: Summary(void) {
+
+    if (!enabled)
+        return "Performance statistics not built in";
+
+    std::ostringstream out;
+    out << "Stats :";
+    for (std::size_t i = 0; i < histograms.size(); i++) {
+        const LatencyHistogram& hist = histograms[i];
+        PerfHistogram h = static_cast<PerfHistogram>(i);
+        out << " " << histogram_names[i] << " [n=" << hist.Count();
+        if (hist.Count() != 0) {
+            out << " p50=";
+            WriteValue(out, h, hist.Percentile(0.5));
+            out << " p99=";
+            WriteValue(out, h, hist.Percentile(0.99));
+            out << " max=";
+            WriteValue(out, h, hist.Max());
+        }
+        out << "]";
+    }
+    for (std::size_t i = 0; i < counters.size(); i++)
+        out << " " << counter_names[i] << " [" << counters[i].load(std::memory_order_relaxed) << "]";
+    return out.str();
+}
+
+std::string PerfStats :: Dump(void) {
+
+    if (!enabled)
+        return "Performance statistics not built in";
+
+    static const struct {
+        double q;
+        const char* name;
+    } quantiles[] = {{0.5, "p50"}, {0.9, "p90"}, {0.99, "p99"}, {0.999, "p99.9"}};
+
+    std::ostringstream out;
+    out << "Performance statistics since start :";
+    for (std::size_t i = 0; i < histograms.size(); i++) {
+        const LatencyHistogram& hist = histograms[i];
+        PerfHistogram h = static_cast<PerfHistogram>(i);
+        out << "\n  " << std::left << std::setw(16) << histogram_names[i] << " count " << hist.Count();
+        if (hist.Count() == 0)
+            continue;
+        out << ", mean ";
+        WriteValue(out, h, hist.Sum() / hist.Count());
+        for (const auto& quantile : quantiles) {
+            out << ", " << quantile.name << " ";
+            WriteValue(out, h, hist.Percentile(quantile.q));
+        }
+        out << ", max ";
+        WriteValue(out, h, hist.Max());
+    }
+    for (std::size_t i = 0; i < counters.size(); i++)
+        out << "\n  " << std::left << std::setw(16) << counter_names[i] << " " << counters[i].load(std::memory_order_relaxed);
+    return out.str();
+}
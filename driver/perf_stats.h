@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Counters and latency histograms of the driver's own work, e.g. how long the device
+// takes to answer a GET or how late the heartbeat timer fires. They are logged as one
+// summary line every --stats_interval seconds and in full on SIGUSR1.
+//
+// Recording is a few relaxed atomic increments. Building without DRIVER_PERF_STATS
+// (cmake -DDRIVER_PERF_STATS=OFF) turns every call below into an empty inline function
+// and PerfStart into an empty struct, so the instrumented code costs nothing.
+
+// Distributions recorded, in nanoseconds unless noted.
+enum class PerfHistogram : uint8_t {
+    HTTPGet,            // From sending a GET to its response being stored
+    HTTPPost,           // From sending a POST to its response
+    GetParamDetails,    // Parsing a control message from RB
+    SendStatus,         // Sending the status params of one update
+    SendCBOR,           // Queueing one frame for RB
+    HeartBeatDrift,     // How late the heartbeat timer fired
+    FramesPerTick,      // Frames sent to RB by one monitor tick (a count)
+    Count
+};
+
+// Events counted.
+enum class PerfCounter : uint8_t {
+    MonitorTicks,       // Monitor ticks run
+    SkippedTicks,       // Ticks skipped as the device was still answering
+    HTTPErrors,         // GETs and POSTs that failed or timed out
+    DeviceEvents,       // Changes pushed by the device
+    NotModified,        // GETs the device answered with 304 Not Modified
+    Count
+};
+
+// An HDR-style histogram : values are bucketed by their power of two, and each power
+// of two is split into SUB_BUCKETS linear sub-buckets, so a value is known to within
+// 1 / SUB_BUCKETS (12.5%) over the whole range of uint64_t, in a fixed 4 KiB.
+// Safe to record into from any thread.
+class LatencyHistogram {
+
+    public:
+    static const unsigned SUB_BITS = 3;
+    static const unsigned SUB_BUCKETS = 1u << SUB_BITS;
+    static const unsigned BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+
+    static unsigned BucketOf(uint64_t value);
+
+    // Largest value falling into a bucket.
+    static uint64_t BucketLimit(unsigned bucket);
+
+    public:
+
+    LatencyHistogram();
+
+    void Record(uint64_t value);
+
+    uint64_t Count(void) const { return count.load(std::memory_order_relaxed); }
+    uint64_t Sum(void) const { return sum.load(std::memory_order_relaxed); }
+    uint64_t Max(void) const { return max.load(std::memory_order_relaxed); }
+
+    // The value below which a fraction 'q' of the recorded values lie, e.g. 0.99.
+    uint64_t Percentile(double q) const;
+};
+
+#ifdef DRIVER_PERF_STATS
+typedef std::chrono::steady_clock::time_point PerfStart;
+#else
+struct PerfStart {};
+#endif
+
+class PerfStats {
+
+    private:
+    static std::array<LatencyHistogram, static_cast<std::size_t>(PerfHistogram::Count)> histograms;
+    static std::array<std::atomic<uint64_t>, static_cast<std::size_t>(PerfCounter::Count)> counters;
+
+    public:
+
+#ifdef DRIVER_PERF_STATS
+    static const bool enabled = true;
+
+    static PerfStart Now(void) { return std::chrono::steady_clock::now(); }
+
+    static void Record(PerfHistogram h, uint64_t value) {
+        histograms[static_cast<std::size_t>(h)].Record(value);
+    }
+
+    static void Record(PerfHistogram h, std::chrono::steady_clock::duration d) {
+        Record(h, static_cast<uint64_t>(std::max(std::chrono::nanoseconds(d).count(), std::chrono::nanoseconds::rep(0))));
+    }
+
+    // Record the time from 'start' to now. Also takes the time an event was due at, to
+    // record how late it is.
+    static void RecordSince(PerfHistogram h, PerfStart start) { Record(h, Now() - start); }
+
+    static void Add(PerfCounter c, uint64_t n = 1) {
+        counters[static_cast<std::size_t>(c)].fetch_add(n, std::memory_order_relaxed);
+    }
+#else
+    static const bool enabled = false;
+
+    static PerfStart Now(void) { return PerfStart(); }
+    static void Record(PerfHistogram, uint64_t) {}
+    static void Record(PerfHistogram, std::chrono::steady_clock::duration) {}
+    template <typename T>
+    static void RecordSince(PerfHistogram, const T&) {}
+    static void Add(PerfCounter, uint64_t = 1) {}
+#endif
+
+    // One line with the count, median, 99th percentile and maximum of each histogram,
+    // and the counters.
+    static std::string Summary(void);
+
+    // Several lines with more percentiles of each histogram.
+    static std::string Dump(void);
+};
+
+// Records the time spent in a scope.
+class PerfScope {
+
+    private:
+    PerfHistogram histogram;
+    PerfStart start;
+
+    public:
+    explicit PerfScope(PerfHistogram h) : histogram(h), start(PerfStats::Now()) {}
+    ~PerfScope() { PerfStats::RecordSince(histogram, start); }
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+};
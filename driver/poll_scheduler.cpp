@@ -0,0 +1,44 @@
+#include "poll_scheduler.h"
+
+#include <algorithm>
+
+std::size_t PollScheduler :: AddGroup(const std::string& target, duration base, unsigned int max_backoff) {
+
+    Group group;
+    group.target = target;
+    group.base = base;
+    group.max = base * std::max(max_backoff, 1u);
+    group.interval = base;
+    group.due = time_point::min();
+    group.polls = 0;
+    groups.push_back(group);
+    return groups.size() - 1;
+}
+
+void PollScheduler :: Due(time_point now, std::vector<std::size_t>& due) const {
+
+    due.clear();
+    for (std::size_t i = 0; i < groups.size(); i++) {
+        if (groups[i].due <= now)
+            due.push_back(i);
+    }
+}
+
+void PollScheduler :: Polled(std::size_t group, time_point now, bool changed) {
+
+    Group& g = groups[group];
+    g.polls++;
+    if (changed)
+        g.interval = g.base;
+    else
+        g.interval = std::min(g.interval * 2, g.max);
+    g.due = now + g.interval;
+}
+
+void PollScheduler :: SpeedUp(time_point now) {
+
+    for (Group& g : groups) {
+        g.interval = g.base;
+        g.due = std::min(g.due, now);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// How often the groups of device params are polled. Each group starts at its base
+// interval, and while its values stay the same the interval doubles after each poll, up
+// to max_backoff times the base. A change in the group, or any alert, brings it back to
+// the base interval.
+struct PollIntervals {
+    std::chrono::steady_clock::duration tick;     // How often the driver checks which groups are due
+    std::chrono::steady_clock::duration status;   // Device status params, e.g. SignalLevel
+    std::chrono::steady_clock::duration ref;      // Referenced status params, e.g. Version, Alert
+    std::chrono::steady_clock::duration full;     // All params, including the control params
+    unsigned int max_backoff;                     // 1 polls every group at its base interval
+
+    PollIntervals() : tick(std::chrono::seconds(5)), status(std::chrono::seconds(5)), ref(std::chrono::seconds(30)),
+                      full(std::chrono::seconds(60)), max_backoff(4) {}
+};
+
+// Decides which groups of device params are due to be polled. It does no I/O : the
+// caller asks for the due groups, fetches them and reports back whether anything changed.
+class PollScheduler {
+
+    public:
+    typedef std::chrono::steady_clock::time_point time_point;
+    typedef std::chrono::steady_clock::duration duration;
+
+    private:
+    struct Group {
+        std::string target;      // HTTP target fetching the group
+        duration base;           // Interval while the group changes
+        duration max;            // Longest interval while it does not
+        duration interval;       // Current interval
+        time_point due;          // When the group is to be polled next
+        unsigned long long polls;
+    };
+
+    std::vector<Group> groups;
+
+    public:
+
+    // Add a group, due straight away. Returns its index.
+    std::size_t AddGroup(const std::string& target, duration base, unsigned int max_backoff);
+
+    // Store the indexes of the groups due at 'now' in 'due'.
+    void Due(time_point now, std::vector<std::size_t>& due) const;
+
+    // Record the poll of a group at 'now' and schedule the next one.
+    void Polled(std::size_t group, time_point now, bool changed);
+
+    // Go back to the base interval of every group and poll them all at the next opportunity,
+    // e.g. after an alert.
+    void SpeedUp(time_point now);
+
+    std::size_t Size(void) const { return groups.size(); }
+    const std::string& Target(std::size_t group) const { return groups[group].target; }
+    duration Interval(std::size_t group) const { return groups[group].interval; }
+    unsigned long long GetPollCount(std::size_t group) const { return groups[group].polls; }
+};
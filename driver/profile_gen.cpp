@@ -0,0 +1,165 @@
+// Generates the C++ profile of a device type, see device_profile.h, from its Abstract
+// Device Specification and the standard parameters. Run by the build.
+//
+// Usage : device-profile-gen <schema_file> <std_params_file> <profile_name> <output_header>
+//
+// The schema is loaded with DeviceSchema::Load itself, so the profile holds exactly the
+// params, IDs, bounds and hash table the driver would get from the XML at run time.
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "driver.h"
+#include "schema_cache.h"
+
+namespace logging = boost::log;
+
+namespace {
+
+// Quote a string as a C++ literal.
+std::string Literal(const std::string& text) {
+
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c == '\n')
+            out << "\\n";
+        else if (c < 0x20 || c >= 0x7f)
+            out << '\\' << std::oct << std::setw(3) << std::setfill('0') << int(c) << std::dec;
+        else
+            out << c;
+    }
+    out << '"';
+    return out.str();
+}
+
+const char* TypeEnum(ParamType type) {
+    switch (type) {
+        case ParamType::Integer:    return "ParamType::Integer";
+        case ParamType::String:     return "ParamType::String";
+        case ParamType::Boolean:    return "ParamType::Boolean";
+        case ParamType::DateTime:   return "ParamType::DateTime";
+        case ParamType::Enumerated: return "ParamType::Enumerated";
+        case ParamType::AlertType:  return "ParamType::AlertType";
+        default:                    return "ParamType::None";
+    }
+}
+
+void WriteProfile(std::ostream& out, const std::string& profile_name, std::uint64_t key,
+                  const std::string& schema_file, const std::string& std_params_file, const DeviceSchema& schema) {
+
+    const ParamRegistry& params = schema.params;
+
+    auto base_name = [](const std::string& path) { return path.substr(path.find_last_of("/\\") + 1); };
+    out << "// Generated by device-profile-gen from " << base_name(schema_file) << " and "
+        << base_name(std_params_file) << ", do not edit.\n\n"
+        << "#pragma once\n\n"
+        << "#include \"device_profile.h\"\n\n"
+        << "struct " << profile_name << " {\n\n"
+        << "    static constexpr const char* name = " << Literal(profile_name) << ";\n"
+        << "    static constexpr std::uint64_t key = 0x" << std::hex << key << std::dec << "ULL;\n"
+        << "    static constexpr const char* device_type = " << Literal(schema.device_type) << ";\n"
+        << "    static constexpr const char* device_family = " << Literal(schema.device_family) << ";\n\n";
+
+    out << "    static constexpr ParamId heartbeat_id = " << schema.heartbeat_id << ";\n"
+        << "    static constexpr ParamId status_id = " << schema.status_id << ";\n"
+        << "    static constexpr ParamId alert_id = " << schema.alert_id << ";\n"
+        << "    static constexpr ParamId alert_message_id = " << schema.alert_message_id << ";\n\n";
+
+    out << "    static constexpr std::size_t param_count = " << params.Size() << ";\n"
+        << "    static const ProfileParam* params(void) {\n"
+        << "        static const ProfileParam table[param_count] = {\n";
+    for (ParamId id = 0; id < params.Size(); id++) {
+        const ParamBounds& bounds = params.Bounds(id);
+        std::string flags;
+        if (bounds.bounded)
+            flags = "PROFILE_BOUNDED";
+        if (schema.skip_status[id])
+            flags += flags.empty() ? "PROFILE_SKIP_STATUS" : " | PROFILE_SKIP_STATUS";
+        out << "            {" << Literal(params.Name(id)) << ", " << TypeEnum(params.Type(id)) << ", "
+            << (flags.empty() ? "0" : flags) << ", " << bounds.lower << ", " << bounds.upper << ", " << bounds.multiplier << ",\n"
+            << "             " << Literal(schema.status_open[id]) << ", " << Literal(schema.status_close[id]) << ", ";
+        std::string enum_values;
+        for (const std::string& value : params.EnumValues(id))
+            enum_values += value + '\0';
+        out << params.EnumValues(id).size() << ", " << Literal(enum_values) << "},\n";
+    }
+    out << "        };\n"
+        << "        return table;\n"
+        << "    }\n\n";
+
+    out << "    static constexpr std::size_t tracked_count = " << schema.tracked_params.size() << ";\n"
+        << "    static const ParamId* tracked(void) {\n"
+        << "        static const ParamId table[tracked_count] = {";
+    for (std::size_t i = 0; i < schema.tracked_params.size(); i++)
+        out << (i % 16 == 0 ? "\n            " : " ") << schema.tracked_params[i] << ",";
+    out << "\n        };\n"
+        << "        return table;\n"
+        << "    }\n\n";
+
+    out << "    static constexpr std::uint64_t seed = 0x" << std::hex << params.Seed() << std::dec << "ULL;\n"
+        << "    static constexpr std::size_t slot_count = " << params.Slots().size() << ";\n"
+        << "    static const ParamId* slots(void) {\n"
+        << "        static const ParamId table[slot_count] = {";
+    for (std::size_t i = 0; i < params.Slots().size(); i++)
+        out << (i % 16 == 0 ? "\n            " : " ") << params.Slots()[i] << ",";
+    out << "\n        };\n"
+        << "        return table;\n"
+        << "    }\n"
+        << "};\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc != 5) {
+        std::cerr << "Usage : " << argv[0] << " <schema_file> <std_params_file> <profile_name> <output_header>\n";
+        return 1;
+    }
+    std::string schema_file(argv[1]);
+    std::string std_params_file(argv[2]);
+    std::string profile_name(argv[3]);
+    std::string output(argv[4]);
+
+    // DeviceSchema::Load logs what it finds, which is of no interest here.
+    logging::core::get()->set_logging_enabled(false);
+
+    std::shared_ptr<const DeviceSchema> schema;
+    std::uint64_t key;
+    try {
+        schema = DeviceSchema::Load(schema_file, std_params_file);
+    } catch (std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return 1;
+    }
+    if (!SchemaCache::Key(schema_file, std_params_file, key)) {
+        std::cerr << "ERROR: Can't read [" << schema_file << "] or [" << std_params_file << "]\n";
+        return 1;
+    }
+
+    std::ostringstream text;
+    WriteProfile(text, profile_name, key, schema_file, std_params_file, *schema);
+
+    // Written under a temporary name, so that a failed run leaves no half written header.
+    std::string temp = output + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        out << text.str();
+        if (!out.flush()) {
+            std::cerr << "ERROR: Can't write [" << temp << "]\n";
+            return 1;
+        }
+    }
+    if (std::rename(temp.c_str(), output.c_str()) != 0) {
+        std::cerr << "ERROR: Can't write [" << output << "]\n";
+        std::remove(temp.c_str());
+        return 1;
+    }
+    return 0;
+}
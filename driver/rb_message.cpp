@@ -0,0 +1,118 @@
+#include "rb_message.h"
+
+#include <cctype>
+
+namespace {
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void SkipSpace(boost::string_view& in) {
+    while (!in.empty() && IsSpace(in.front()))
+        in.remove_prefix(1);
+}
+
+// Read "<name>" or "<name/>" and return the name. Anything else, including attributes,
+// declarations and comments, is not part of the grammar.
+bool ReadOpenTag(boost::string_view& in, boost::string_view& name, bool& empty) {
+
+    if (in.size() < 3 || in[0] != '<')
+        return false;
+
+    std::size_t end = in.find('>');
+    if (end == boost::string_view::npos)
+        return false;
+
+    name = in.substr(1, end - 1);
+    empty = !name.empty() && name.back() == '/';
+    if (empty)
+        name.remove_suffix(1);
+    if (name.empty())
+        return false;
+    for (char c : name) {
+        if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.'))
+            return false;
+    }
+    in.remove_prefix(end + 1);
+    return true;
+}
+
+// Read "</name>".
+bool ReadCloseTag(boost::string_view& in, boost::string_view name) {
+
+    if (in.size() < name.size() + 3 || in[0] != '<' || in[1] != '/')
+        return false;
+    if (in.substr(2, name.size()) != name || in[name.size() + 2] != '>')
+        return false;
+    in.remove_prefix(name.size() + 3);
+    return true;
+}
+
+}
+
+bool RBMessage :: Scan(boost::string_view msg) {
+
+    *this = RBMessage();
+
+    boost::string_view in = msg;
+    bool empty;
+
+    SkipSpace(in);
+    if (!ReadOpenTag(in, root, empty) || empty)
+        return false;
+    if (root != "Control" && root != "Status")
+        return false;
+
+    bool have_device = false;
+    bool have_device_type = false;
+    bool have_param = false;
+
+    while (true) {
+        SkipSpace(in);
+        if (ReadCloseTag(in, root))
+            break;
+
+        boost::string_view name;
+        if (!ReadOpenTag(in, name, empty))
+            return false;
+
+        boost::string_view text;
+        if (!empty) {
+            // Text with markup or entity references in it needs the real XML parser.
+            std::size_t end = in.find_first_of("<&");
+            if (end == boost::string_view::npos || in[end] != '<')
+                return false;
+            text = in.substr(0, end);
+            in.remove_prefix(end);
+            if (!ReadCloseTag(in, name))
+                return false;
+        }
+
+        // Each element may occur once, and there is at most one typed value.
+        if (name == "Device") {
+            if (have_device)
+                return false;
+            have_device = true;
+            device = text;
+        } else if (name == "DeviceType") {
+            if (have_device_type)
+                return false;
+            have_device_type = true;
+            device_type = text;
+        } else if (name == "Param") {
+            if (have_param)
+                return false;
+            have_param = true;
+            param = text;
+        } else {
+            if (!value_type.empty())
+                return false;
+            value_type = name;
+            value = text;
+        }
+    }
+
+    SkipSpace(in);
+    return in.empty() && have_param;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <boost/utility/string_view.hpp>
+
+// The fields of a Red/Black <Control> or <Status> message, as views into the message
+// text. A message has a fixed, flat layout :
+//
+//      <Control>
+//          <Device>Radio</Device>
+//          <DeviceType>IsodeRadio</DeviceType>
+//          <Param>Frequency</Param>
+//          <Integer>22917</Integer>
+//      </Control>
+//
+// Scan() reads exactly this layout in a single pass without allocating. It gives up on
+// anything else, e.g. attributes, comments, entities or nested elements, and the caller
+// then falls back to a general XML parser.
+struct RBMessage {
+    boost::string_view root;          // "Control" or "Status"
+    boost::string_view device;        // Text of <Device>
+    boost::string_view device_type;   // Text of <DeviceType>
+    boost::string_view param;         // Text of <Param>
+    boost::string_view value_type;    // Name of the typed value element, empty if there is none
+    boost::string_view value;         // Text of the typed value element
+
+    // Fill in the fields from 'msg'. Returns false if the message is not laid out as above.
+    // The fields point into 'msg', which must outlive them.
+    bool Scan(boost::string_view msg);
+};
@@ -0,0 +1,328 @@
+#include "schema_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "driver.h"
+
+namespace logging = boost::log;
+namespace src = boost::log::sources;
+namespace ipc = boost::interprocess;
+
+namespace {
+
+const char image_magic[8] = {'R', 'B', 'S', 'C', 'H', 'E', 'M', 'A'};
+const std::uint32_t byte_order_mark = 0x01020304;
+
+// Layout of the image, in the byte order of the machine writing it :
+//
+//      ImageHeader
+//      ImageParam      [param_count]
+//      ParamId         [tracked_count]
+//      ParamId         [slot_count]
+//      char            [strings_size]    names, enum values, device type and device family
+struct ImageHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t key;
+    std::uint64_t seed;
+    std::uint32_t param_count;
+    std::uint32_t tracked_count;
+    std::uint32_t slot_count;
+    std::uint32_t strings_size;
+    std::uint32_t device_type_offset;
+    std::uint32_t device_type_size;
+    std::uint32_t device_family_offset;
+    std::uint32_t device_family_size;
+    ParamId heartbeat_id;
+    ParamId status_id;
+    ParamId alert_id;
+    ParamId alert_message_id;
+};
+
+enum ImageParamFlags : std::uint8_t {
+    PARAM_BOUNDED = 1,
+    PARAM_SKIP_STATUS = 2,
+};
+
+struct ImageParam {
+    std::int64_t lower;
+    std::int64_t upper;
+    std::int64_t multiplier;
+    std::uint32_t name_offset;
+    std::uint16_t name_size;
+    std::uint8_t type;
+    std::uint8_t flags;
+    std::uint32_t enum_offset;     // Enum values, each followed by a '\0'
+    std::uint32_t enum_size;
+};
+
+static_assert(sizeof(ImageParam) == 40, "ImageParam must have no padding that varies between compilers");
+
+// FNV-1a, which is plenty to tell one version of the XML from another.
+std::uint64_t Hash(const std::string& data, std::uint64_t h) {
+    for (char c : data) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+bool ReadFile(const std::string& file_name, std::string& contents) {
+    std::ifstream in(file_name, std::ios::binary | std::ios::ate);
+    if (!in)
+        return false;
+    contents.resize(static_cast<std::size_t>(in.tellg()));
+    in.seekg(0);
+    return static_cast<bool>(in.read(&contents[0], contents.size()));
+}
+
+// Append a string to the string pool and return its offset.
+std::uint32_t AddString(std::string& strings, const std::string& s) {
+    std::uint32_t offset = static_cast<std::uint32_t>(strings.size());
+    strings += s;
+    return offset;
+}
+
+}
+
+bool SchemaCache :: Key(const std::string& schema_file, const std::string& std_params_file, std::uint64_t& key) {
+
+    std::string schema, std_params;
+    if (!ReadFile(schema_file, schema) || !ReadFile(std_params_file, std_params))
+        return false;
+
+    // The lengths keep the boundary between the two files part of the key.
+    key = Hash(schema, 0xcbf29ce484222325ULL ^ schema.size());
+    key = Hash(std_params, key ^ std_params.size());
+    return true;
+}
+
+std::string SchemaCache :: ImagePath(const std::string& dir, std::uint64_t key) {
+    std::ostringstream path;
+    path << dir << "/isode-radio-schema-" << std::hex << key << ".v" << std::dec << VERSION << ".bin";
+    return path.str();
+}
+
+bool SchemaCache :: Write(const std::string& path, std::uint64_t key, const DeviceSchema& schema) {
+
+    const ParamRegistry& params = schema.params;
+
+    ImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, image_magic, sizeof(image_magic));
+    header.version = VERSION;
+    header.byte_order = byte_order_mark;
+    header.key = key;
+    header.seed = params.Seed();
+    header.param_count = static_cast<std::uint32_t>(params.Size());
+    header.tracked_count = static_cast<std::uint32_t>(schema.tracked_params.size());
+    header.slot_count = static_cast<std::uint32_t>(params.Slots().size());
+    header.heartbeat_id = schema.heartbeat_id;
+    header.status_id = schema.status_id;
+    header.alert_id = schema.alert_id;
+    header.alert_message_id = schema.alert_message_id;
+
+    std::string strings;
+    std::vector<ImageParam> records(params.Size());
+    for (ParamId id = 0; id < params.Size(); id++) {
+        ImageParam& record = records[id];
+        std::memset(&record, 0, sizeof(record));
+        const ParamBounds& bounds = params.Bounds(id);
+        record.lower = bounds.lower;
+        record.upper = bounds.upper;
+        record.multiplier = bounds.multiplier;
+        record.name_offset = AddString(strings, params.Name(id));
+        record.name_size = static_cast<std::uint16_t>(params.Name(id).size());
+        record.type = static_cast<std::uint8_t>(params.Type(id));
+        record.flags = (bounds.bounded ? PARAM_BOUNDED : 0) | (schema.skip_status[id] ? PARAM_SKIP_STATUS : 0);
+        record.enum_offset = static_cast<std::uint32_t>(strings.size());
+        for (const std::string& value : params.EnumValues(id)) {
+            AddString(strings, value);
+            strings += '\0';
+        }
+        record.enum_size = static_cast<std::uint32_t>(strings.size() - record.enum_offset);
+    }
+    header.device_type_offset = AddString(strings, schema.device_type);
+    header.device_type_size = static_cast<std::uint32_t>(schema.device_type.size());
+    header.device_family_offset = AddString(strings, schema.device_family);
+    header.device_family_size = static_cast<std::uint32_t>(schema.device_family.size());
+    header.strings_size = static_cast<std::uint32_t>(strings.size());
+
+    std::string temp = path + "." + std::to_string(std::random_device()());
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(ImageParam));
+        out.write(reinterpret_cast<const char*>(schema.tracked_params.data()), schema.tracked_params.size() * sizeof(ParamId));
+        out.write(reinterpret_cast<const char*>(params.Slots().data()), params.Slots().size() * sizeof(ParamId));
+        out.write(strings.data(), strings.size());
+        if (!out.flush()) {
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+#ifndef _WIN32
+    // Whatever the umask, so that Read() takes the image.
+    chmod(temp.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+#endif
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const DeviceSchema> SchemaCache :: Read(const std::string& path, std::uint64_t key) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    ipc::mapped_region region;
+    try {
+        ipc::file_mapping file(path.c_str(), ipc::read_only);
+
+#ifndef _WIN32
+        // The image is trusted as it stands, so only take one that nobody but this user
+        // could have written, e.g. not one planted under the same name in a shared /tmp.
+        // The file checked is the one opened, whatever happens to the path meanwhile.
+        struct stat st;
+        if (fstat(file.get_mapping_handle().handle, &st) != 0 || !S_ISREG(st.st_mode) ||
+            st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+            BOOST_LOG_SEV(lg, warning) << "Ignoring schema image [" << path
+                                       << "], it is not owned by this user or is writable by others";
+            return nullptr;
+        }
+#endif
+        region = ipc::mapped_region(file, ipc::read_only);
+    } catch (ipc::interprocess_exception&) {
+        return nullptr;
+    }
+
+    const char* data = static_cast<const char*>(region.get_address());
+    std::size_t size = region.get_size();
+
+    ImageHeader header;
+    if (size < sizeof(header))
+        return nullptr;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, image_magic, sizeof(image_magic)) != 0 || header.version != VERSION ||
+        header.byte_order != byte_order_mark || header.key != key)
+        return nullptr;
+
+    // Every offset is checked against the size, as the file may have been cut short.
+    std::size_t records_at = sizeof(header);
+    std::size_t tracked_at = records_at + std::size_t(header.param_count) * sizeof(ImageParam);
+    std::size_t slots_at = tracked_at + std::size_t(header.tracked_count) * sizeof(ParamId);
+    std::size_t strings_at = slots_at + std::size_t(header.slot_count) * sizeof(ParamId);
+    if (strings_at + header.strings_size != size || header.param_count >= NO_PARAM ||
+        std::size_t(header.device_type_offset) + header.device_type_size > header.strings_size ||
+        std::size_t(header.device_family_offset) + header.device_family_size > header.strings_size)
+        return nullptr;
+    const char* strings = data + strings_at;
+
+    std::shared_ptr<DeviceSchema> schema = std::make_shared<DeviceSchema>();
+    schema->device_type.assign(strings + header.device_type_offset, header.device_type_size);
+    schema->device_family.assign(strings + header.device_family_offset, header.device_family_size);
+
+    std::vector<std::string> names(header.param_count);
+    std::vector<ParamType> types(header.param_count);
+    std::vector<ParamBounds> bounds(header.param_count);
+    std::vector<std::vector<std::string>> enum_values(header.param_count);
+    schema->skip_status.assign(header.param_count, 0);
+    for (std::size_t id = 0; id < header.param_count; id++) {
+        ImageParam record;
+        std::memcpy(&record, data + records_at + id * sizeof(ImageParam), sizeof(record));
+        if (std::size_t(record.name_offset) + record.name_size > header.strings_size ||
+            std::size_t(record.enum_offset) + record.enum_size > header.strings_size ||
+            (record.enum_size != 0 && strings[record.enum_offset + record.enum_size - 1] != '\0') ||
+            record.type > static_cast<std::uint8_t>(ParamType::AlertType))
+            return nullptr;
+        for (const char* value = strings + record.enum_offset; value < strings + record.enum_offset + record.enum_size;
+             value += enum_values[id].back().size() + 1)
+            enum_values[id].emplace_back(value);
+        names[id].assign(strings + record.name_offset, record.name_size);
+        types[id] = static_cast<ParamType>(record.type);
+        bounds[id].bounded = (record.flags & PARAM_BOUNDED) != 0;
+        bounds[id].lower = record.lower;
+        bounds[id].upper = record.upper;
+        bounds[id].multiplier = record.multiplier;
+        schema->skip_status[id] = (record.flags & PARAM_SKIP_STATUS) != 0;
+    }
+
+    schema->tracked_params.resize(header.tracked_count);
+    std::memcpy(schema->tracked_params.data(), data + tracked_at, header.tracked_count * sizeof(ParamId));
+    std::vector<ParamId> slots(header.slot_count);
+    std::memcpy(slots.data(), data + slots_at, header.slot_count * sizeof(ParamId));
+
+    // IDs index the arrays above, so one out of range means the image is not to be trusted.
+    for (ParamId id : schema->tracked_params) {
+        if (id >= header.param_count)
+            return nullptr;
+    }
+    for (ParamId id : slots) {
+        if (id != NO_PARAM && id >= header.param_count)
+            return nullptr;
+    }
+    if ((header.slot_count & (header.slot_count - 1)) != 0 || header.slot_count < header.param_count ||
+        header.heartbeat_id >= header.param_count || header.status_id >= header.param_count ||
+        header.alert_id >= header.param_count || header.alert_message_id >= header.param_count)
+        return nullptr;
+
+    schema->params.Restore(std::move(names), std::move(types), std::move(bounds), std::move(slots), header.seed);
+    for (ParamId id = 0; id < header.param_count; id++)
+        schema->params.SetEnumValues(id, std::move(enum_values[id]));
+    schema->heartbeat_id = header.heartbeat_id;
+    schema->status_id = header.status_id;
+    schema->alert_id = header.alert_id;
+    schema->alert_message_id = header.alert_message_id;
+    schema->BuildStatusFragments();
+    return schema;
+}
+
+std::shared_ptr<const DeviceSchema> SchemaCache :: Load(const std::string& dir, const std::string& schema_file,
+                                                        const std::string& std_params_file,
+                                                        const std::vector<CompiledSchema>& compiled) {
+
+    using namespace logging::trivial;
+    src::severity_logger<severity_level> lg;
+
+    std::uint64_t key;
+    if ((dir.empty() && compiled.empty()) || !Key(schema_file, std_params_file, key))
+        return DeviceSchema::Load(schema_file, std_params_file);
+
+    for (const CompiledSchema& c : compiled) {
+        if (c.key == key) {
+            BOOST_LOG_SEV(lg, info) << "Using compiled profile [" << c.name << "] for schema [" << schema_file << "]";
+            return c.make();
+        }
+    }
+    if (dir.empty())
+        return DeviceSchema::Load(schema_file, std_params_file);
+
+    std::string path = ImagePath(dir, key);
+    std::shared_ptr<const DeviceSchema> schema = Read(path, key);
+    if (schema) {
+        BOOST_LOG_SEV(lg, info) << "Loaded [" << schema->params.Size() << "] params from schema image [" << path << "]";
+        return schema;
+    }
+
+    schema = DeviceSchema::Load(schema_file, std_params_file);
+    if (Write(path, key, *schema))
+        BOOST_LOG_SEV(lg, info) << "Saved schema image [" << path << "]";
+    else
+        BOOST_LOG_SEV(lg, warning) << "Cannot write schema image [" << path << "]";
+    return schema;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct DeviceSchema;
+
+// A schema built into the driver from the XML at compile time, see device_profile.h.
+struct CompiledSchema {
+    const char* name;              // Name of the profile, for the log
+    std::uint64_t key;             // SchemaCache::Key of the files it was generated from
+    std::shared_ptr<const DeviceSchema> (*make)(void);
+};
+
+// Keeps a compiled image of a DeviceSchema next to the XML it was parsed from, so that a
+// driver starting again with the same files maps the image in rather than parsing the XML.
+//
+// The image is a flat, versioned binary file : a header, then fixed size records of the
+// params (type, bounds, enum values, flags), the tracked param IDs, the perfect hash table of the
+// registry and the param names. Loading it checks the header and copies the arrays out;
+// nothing is parsed or hashed. Images are named after the 64 bit hash of the contents of
+// both XML files, so a changed file simply gets a new image.
+class SchemaCache {
+
+    public:
+
+    // Bumped whenever the layout of the image or the meaning of a field changes.
+    static const std::uint32_t VERSION = 2;
+
+    // The schema described by the two files : from an image in 'dir' made from their
+    // current contents if there is one, otherwise parsed from the XML and saved to 'dir'.
+    // With an empty 'dir' the XML is always parsed. A compiled schema made from the same
+    // contents is used before either. Throws like DeviceSchema::Load.
+    static std::shared_ptr<const DeviceSchema> Load(const std::string& dir, const std::string& schema_file,
+                                                    const std::string& std_params_file,
+                                                    const std::vector<CompiledSchema>& compiled = {});
+
+    // Hash the contents of the two files. Returns false if either cannot be read.
+    static bool Key(const std::string& schema_file, const std::string& std_params_file, std::uint64_t& key);
+
+    // Path of the image of the files with 'key' in 'dir'.
+    static std::string ImagePath(const std::string& dir, std::uint64_t key);
+
+    // Write the image of a schema. It is written under a temporary name and renamed, so
+    // a driver starting at the same time never maps a partly written image.
+    static bool Write(const std::string& path, std::uint64_t key, const DeviceSchema& schema);
+
+    // Map an image in. Returns null if there is none, or it is of another version or key.
+    static std::shared_ptr<const DeviceSchema> Read(const std::string& path, std::uint64_t key);
+};